@@ -17,9 +17,15 @@
 #include <linux/dma-mapping.h>
 #include <linux/spinlock.h>
 #include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/average.h>
+#include <linux/dynamic_queue_limits.h>
+#include <net/mac80211.h>
 
 #include "mt7927_regs.h"
 
+struct seq_file;
+
 /* ============================================
  * Device Identification
  * ============================================ */
@@ -37,7 +43,7 @@
 struct mt7927_desc {
     __le32 buf0;        /* Buffer pointer (low 32 bits) */
     __le32 ctrl;        /* Control: length, last segment, DMA done */
-    __le32 buf1;        /* Buffer pointer (high 32 bits, for 64-bit DMA) */
+    __le32 buf1;        /* Second segment (SD_LEN1), else high address bits */
     __le32 info;        /* Additional info */
 } __packed __aligned(4);
 
@@ -45,6 +51,45 @@ struct mt7927_desc {
  * DMA Queue Structure
  * ============================================ */
 
+/*
+ * How a thread waiting on a ring learns that the hardware is done:
+ * IRQ sleeps until the interrupt path reports it, POLL checks the ring
+ * periodically without relying on the interrupt, HYBRID spins for a short
+ * window sized from recent latency and then sleeps on the interrupt.
+ */
+enum mt7927_compl_mode {
+    MT7927_COMPL_IRQ,
+    MT7927_COMPL_HYBRID,
+    MT7927_COMPL_POLL,
+    __MT7927_COMPL_MAX,
+};
+
+enum mt7927_compl_by {
+    MT7927_COMPL_BY_POLL,               /* Seen while spinning/polling */
+    MT7927_COMPL_BY_IRQ,                /* Woken by the interrupt path */
+    MT7927_COMPL_BY_TIMEOUT,
+};
+
+/* Longest busy-wait before falling back to the interrupt */
+#define MT7927_COMPL_SPIN_MAX_US        50
+
+DECLARE_EWMA(compl_lat, 4, 8)
+
+struct mt7927_compl {
+    enum mt7927_compl_mode mode;
+    struct ewma_compl_lat lat_us;       /* Recent completion latency */
+    u32 waits;
+    u32 polled;
+    u32 irq;
+    u32 timeouts;
+};
+
+/* Streaming mappings (or bounce slots) behind one TX descriptor */
+struct mt7927_tx_map {
+    dma_addr_t addr[2];                 /* buf0, buf1 */
+    u32 len[2];                         /* 0: caller-owned or unused */
+};
+
 struct mt7927_queue {
     /* Descriptor ring */
     struct mt7927_desc *desc;
@@ -52,19 +97,48 @@ struct mt7927_queue {
     int ndesc;
 
     /* Buffer management */
-    struct sk_buff **skb;
-    dma_addr_t *dma_addr;
+    struct sk_buff **skb;   /* TX: frame, on its last descriptor */
+    void **buf;             /* RX: page-fragment buffer per descriptor */
+    dma_addr_t *dma_addr;   /* RX */
+    struct mt7927_tx_map *map;  /* TX: released when the descriptor completes */
+
+    /* TX: coherent slots for small frames, mapped for the ring's life */
+    struct {
+        void *buf;
+        dma_addr_t dma;
+        u16 *free;          /* Stack of free slot numbers */
+        int nfree;
+        int nslots;
+    } bounce;
+
+    /* RX: frame the DMA split over several buffers, being assembled */
+    struct sk_buff *rx_head;
+    bool rx_discard;        /* Drop buffers up to the end of this frame */
 
     /* Ring indices */
     int head;               /* CPU write index */
     int tail;               /* DMA read index (from hardware) */
 
+    /* Frames queued (TX) or received (RX), for the link PM policy */
+    u32 frames;
+
     /* Queue identification */
     int hw_idx;             /* Hardware queue index */
-    bool stopped;
+    u32 ring_base;          /* Ring register block */
+    int buf_size;           /* RX buffer size (0 for TX queues) */
+    bool stopped;           /* TX data ring: scheduler paused until wake */
+
+    /* TX data ring: byte queue limit on what sits in the ring */
+    struct dql dql;
+    u32 stops;
 
     /* Spinlock for queue access */
     spinlock_t lock;
+    spinlock_t cleanup_lock;    /* TX: one reaper at a time, outside lock */
+
+    /* Threads waiting for the ring (MCU and FWDL rings) */
+    wait_queue_head_t wait;
+    struct mt7927_compl compl;
 };
 
 /* ============================================
@@ -95,11 +169,287 @@ enum mt7927_mcu_state {
     MT7927_MCU_STATE_ERROR,
 };
 
+/*
+ * Outstanding MCU commands, indexed by the 4-bit TXD sequence number.
+ * Sequence 0 is never handed out: fire-and-forget commands use it and
+ * firmware reports unsolicited events with it.
+ */
+#define MT7927_MCU_SEQ_NUM              16
+
+enum mt7927_mcu_req_state {
+    MT7927_MCU_REQ_FREE = 0,
+    MT7927_MCU_REQ_WAITING,             /* Sender waiting on @done */
+    MT7927_MCU_REQ_STALE,               /* Timed out, response may still come */
+};
+
+struct mt7927_mcu_req {
+    struct completion done;
+    struct sk_buff *skb;                /* Response, handed over by RX */
+    unsigned long stale_until;          /* Reusable after this (STALE only) */
+    u64 sent_ns;                        /* Enqueue time, for latency stats */
+    int cmd;
+    enum mt7927_mcu_req_state state;
+};
+
+/* Per-message state carried in skb->cb while an MCU message is in flight */
+struct mt7927_mcu_cb {
+    int cmd;
+    u64 enqueue_ns;                     /* 0: not accounted */
+};
+
+#define MT7927_MCU_CB(skb)      ((struct mt7927_mcu_cb *)(skb)->cb)
+
+/*
+ * MCU round-trip latency, per command. Histograms are per-CPU log2(us)
+ * buckets: bucket 0 is < 1 us, bucket n is [2^(n-1), 2^n) us, the last
+ * bucket absorbs everything slower. Command slots are claimed on first use.
+ */
+#define MT7927_MCU_LAT_BUCKETS          24
+#define MT7927_MCU_LAT_SLOTS            32
+#define MT7927_MCU_LAT_KEY_VALID        BIT(31)
+
+enum mt7927_mcu_lat_type {
+    MT7927_MCU_LAT_DMA,                 /* Enqueue -> TX DMA done */
+    MT7927_MCU_LAT_RESP,                /* Enqueue -> response received */
+    __MT7927_MCU_LAT_MAX,
+};
+
+struct mt7927_mcu_lat_slot {
+    u32 hist[__MT7927_MCU_LAT_MAX][MT7927_MCU_LAT_BUCKETS];
+    u32 timeouts;
+};
+
+struct mt7927_mcu_lat {
+    struct mt7927_mcu_lat_slot slot[MT7927_MCU_LAT_SLOTS];
+    u32 untracked;                      /* Samples for commands without a slot */
+};
+
+/*
+ * Capability/configuration query responses, reused across resets and
+ * resume while the same firmware runs on the same hardware revision.
+ */
+struct mt7927_fw_ident {
+    char patch_build[16];
+    char ram_ver[10];
+    char ram_build[15];
+    u8 hw_rev;
+};
+
+/*
+ * Expected per-region CRC32s of one image: from a "<image>.crc32" manifest
+ * of little-endian words, or learned from the first download of the same
+ * build after which the firmware booted.
+ */
+struct mt7927_fw_crc {
+    u32 *crc;
+    u32 *pending;                       /* Learned, kept once the firmware boots */
+    int n_region;
+    bool manifest;
+    struct mt7927_fw_ident ident;       /* Build the learned values belong to */
+};
+
+/* Radio capabilities from the firmware's NIC capability report */
+struct mt7927_nic_cap {
+    bool valid;
+    u8 antenna_mask;
+    bool has_2ghz;
+    bool has_5ghz;
+};
+
+struct mt7927_mcu_cache_entry {
+    struct list_head list;
+    int cmd;
+    int req_len;
+    struct sk_buff *resp;               /* Response as returned by the MCU */
+    u8 req[];                           /* Query payload, part of the key */
+};
+
+struct mt7927_mcu_cache {
+    struct mutex lock;
+    struct list_head entries;
+    struct mt7927_fw_ident ident;       /* Firmware the entries belong to */
+    bool valid;
+    u32 hits;
+    u32 misses;
+    u32 flushes;
+};
+
+/*
+ * Unsolicited MCU events, dispatched by event ID on an ordered workqueue.
+ * Handlers run in process context and must not free the skb.
+ */
+#define MT7927_MCU_EVENT_NUM            256
+
+struct mt7927_dev;
+typedef void (*mt7927_mcu_event_fn)(struct mt7927_dev *dev, struct sk_buff *skb);
+
+struct mt7927_mcu_event {
+    mt7927_mcu_event_fn handler;
+    u32 count;                          /* Received with this event ID */
+};
+
+/* ============================================
+ * mac80211 Interface State
+ * ============================================ */
+
+/*
+ * WTBL (WLAN table) entries: one per station plus one per interface for
+ * group-addressed frames. Entry 0 is kept for frames without a vif.
+ */
+#define MT7927_WTBL_SIZE                20
+#define MT7927_WTBL_GLOBAL              0
+#define MT7927_MAX_INTERFACES           4
+
+/* Leading CCK entries of the rate table, absent from the 5 GHz band */
+#define MT7927_CCK_RATES                4
+
+/*
+ * Software A-MSDU. mac80211 only aggregates frames it frames itself, so
+ * enabling it turns 802.3 encapsulation offload off for new interfaces.
+ */
+struct mt7927_amsdu {
+    bool enable;
+    u32 max_len;                        /* Per-station cap, 0: negotiated */
+    u32 hist[MT7927_TX_AMSDU_MAX_SUBFRAMES];    /* Frames by subframes */
+};
+
+struct mt7927_vif {
+    u8 idx;                             /* Own MAC index (TXD1 OWN_MAC) */
+    u8 band_idx;
+    u16 bc_wcid;                        /* WTBL entry for group frames */
+};
+
+/* Station connection state in STA_REC_BASIC */
+#define CONN_STATE_DISCONNECT           0
+#define CONN_STATE_CONNECT              1
+#define CONN_STATE_PORT_SECURE          2
+
+struct mt7927_sta {
+    struct mt7927_vif *vif;
+    u16 wcid;
+
+    /*
+     * 802.3 TXD template built at association: only the per-frame
+     * fields (length, queue, TID, ethertype, no-ack) are patched in.
+     */
+    __le32 txd[MT_TXD_SIZE / 4];
+    bool txd_valid;                     /* Written with release semantics */
+    bool decap;                         /* RX header translation enabled */
+};
+
+/* TXD of one data frame, DMA'd as segment 0 ahead of the untouched skb */
+struct mt7927_txwi {
+    __le32 *txd;                        /* Coherent, MT_TXD_SIZE bytes */
+    dma_addr_t dma;
+    struct list_head list;              /* Free list */
+};
+
+struct mt7927_txwi_cache {
+    struct mt7927_txwi *ent;
+    void *buf;                          /* MT7927_TXWI_NUM TXDs */
+    dma_addr_t dma;
+    struct list_head free;              /* LIFO: reuse the hottest TXD */
+    spinlock_t lock;
+};
+
+/* Per-frame driver state of a data frame, kept in the tx_info status area */
+struct mt7927_tx_cb {
+    struct mt7927_txwi *txwi;
+};
+
+#define MT7927_TX_CB(skb) \
+    ((struct mt7927_tx_cb *)IEEE80211_SKB_CB(skb)->status.status_driver_data)
+
+/*
+ * Retries of a function-level reset while the PCI device lock is busy:
+ * the delay doubles from MT7927_RESET_RETRY_DELAY each time, 630 ms in
+ * all before recovery goes ahead without the FLR.
+ */
+#define MT7927_RESET_RETRY_MAX          6
+#define MT7927_RESET_RETRY_DELAY        msecs_to_jiffies(10)
+
+/* Recovery attempts whose bring-up failed, before the chip is given up */
+#define MT7927_RESET_ATTEMPTS_MAX       3
+#define MT7927_RESET_ATTEMPT_DELAY      msecs_to_jiffies(1000)
+
+/* ============================================
+ * Runtime Power Management
+ * ============================================ */
+
+/* Default idle period before LPCTL ownership goes back to firmware */
+#define MT7927_PM_TIMEOUT               (HZ / 12)
+
+struct mt7927_pm_stats {
+    u32 doze_count;                     /* driver -> firmware transitions */
+    u32 wake_count;                     /* firmware -> driver transitions */
+    u32 wake_lat_last_us;
+    u32 wake_lat_max_us;
+    u64 wake_lat_total_us;
+    unsigned long doze_time;            /* jiffies spent firmware-owned */
+    unsigned long awake_time;           /* jiffies spent driver-owned */
+    unsigned long last_change;
+};
+
+struct mt7927_pm {
+    struct delayed_work ps_work;        /* Idle -> hand chip to firmware */
+    struct work_struct wake_work;       /* Lazy wake for atomic users */
+    struct sk_buff_head tx_q;           /* Data frames parked while dozing */
+
+    spinlock_t lock;                    /* Protects fw_own/users/activity */
+    struct mutex mutex;                 /* Serializes LPCTL transitions */
+
+    unsigned long last_activity;
+    unsigned long idle_timeout;
+    int users;
+    bool fw_own;
+    bool enable;
+
+    struct mt7927_pm_stats stats;
+};
+
+/*
+ * Link (ASPM) power policy: sample traffic every MT7927_LINK_PM_INTERVAL
+ * and switch between low-power (L0s/L1/L1.x allowed) and performance
+ * (ASPM off) with hysteresis on both edges.
+ */
+#define MT7927_LINK_PM_INTERVAL         (HZ / 10)
+#define MT7927_LINK_PM_HIGH_FRAMES      200     /* per interval, to go perf */
+#define MT7927_LINK_PM_LOW_FRAMES       50      /* per interval, to go idle */
+#define MT7927_LINK_PM_HIGH_SAMPLES     2
+#define MT7927_LINK_PM_LOW_SAMPLES      10
+
+#define MT7927_LINK_PM_STATES           (PCIE_LINK_STATE_L0S | \
+                                         PCIE_LINK_STATE_L1 | \
+                                         PCIE_LINK_STATE_L1_1 | \
+                                         PCIE_LINK_STATE_L1_2)
+
+enum mt7927_link_pm_state {
+    MT7927_LINK_PM_LOW_POWER = 0,       /* ASPM enabled */
+    MT7927_LINK_PM_PERF,                /* ASPM disabled */
+    __MT7927_LINK_PM_MAX,
+};
+
+struct mt7927_link_pm {
+    struct delayed_work work;
+    enum mt7927_link_pm_state state;
+    bool enable;
+
+    u32 last_frames;
+    unsigned long lat_hint;             /* jiffies of last latency hint */
+    u8 high_samples;
+    u8 low_samples;
+
+    u32 transitions;
+    unsigned long time[__MT7927_LINK_PM_MAX];   /* jiffies per state */
+    unsigned long last_change;
+};
+
 /* ============================================
  * Device Structure
  * ============================================ */
 
 struct mt7927_dev {
+    struct ieee80211_hw *hw;            /* Owns this structure (hw->priv) */
     struct pci_dev *pdev;
     struct device *dev;
 
@@ -115,22 +465,50 @@ struct mt7927_dev {
     struct mt7927_queue tx_q[4];        /* TX queues */
     struct mt7927_queue rx_q[4];        /* RX queues */
     struct mt7927_queue *q_mcu[__MT_MCUQ_MAX];  /* MCU queue pointers */
+    struct mt7927_txwi_cache txwi;      /* TXDs of frames on tx_q[0] */
+    u32 rx_copybreak;                   /* Copy RX frames up to this size */
 
-    /* Firmware */
+    /* Firmware (kept across resets so recovery does not re-request it) */
     const struct firmware *fw_ram;
     const struct firmware *fw_patch;
+    struct mt7927_mcu_cache fw_cache;   /* Query responses for these images */
+    struct mt7927_fw_ident fw_ident;    /* Headers of the images last loaded */
+    size_t fw_patch_size;               /* Image sizes when streaming */
+    size_t fw_ram_size;
+    struct mt7927_fw_crc fw_patch_crc;
+    struct mt7927_fw_crc fw_ram_crc;
+
+    /* Known-good PCI config space, restored after function-level reset */
+    struct pci_saved_state *pci_state;
 
     /* MCU communication */
     struct {
-        struct sk_buff_head res_q;      /* Response queue */
-        wait_queue_head_t wait;         /* Wait queue for responses */
+        struct mt7927_mcu_req req[MT7927_MCU_SEQ_NUM];
+        spinlock_t lock;                /* Protects req[] and seq */
+        wait_queue_head_t wait;         /* Waiters for a free sequence */
         u32 timeout;                    /* MCU timeout in jiffies */
-        u8 seq;                         /* Sequence number */
+        u8 seq;                         /* Next sequence to try */
         enum mt7927_mcu_state state;
+
+        /* Unsolicited events */
+        struct workqueue_struct *event_wq;
+        struct work_struct event_work;
+        struct sk_buff_head event_q;
+        struct mt7927_mcu_event events[MT7927_MCU_EVENT_NUM];
+        u32 event_unhandled;
+        u32 event_backlog_max;
+
+        /* Latency accounting */
+        struct mt7927_mcu_lat __percpu *lat;
+        u32 lat_key[MT7927_MCU_LAT_SLOTS];  /* cmd | KEY_VALID, 0 if free */
+        u32 seq_mismatch;               /* Responses with no matching waiter */
     } mcu;
 
     /* IRQ handling */
     struct tasklet_struct irq_tasklet;
+    struct net_device *napi_dev;        /* Dummy netdev hosting the NAPIs */
+    struct napi_struct rx_napi;         /* Band0 data RX ring */
+    struct napi_struct tx_napi;         /* Band0 data TX completions */
     const struct mt7927_irq_map *irq_map;
     int irq;
 
@@ -145,10 +523,29 @@ struct mt7927_dev {
     bool fw_assert;
 
     /* Work structures */
-    struct work_struct reset_work;
+    struct delayed_work reset_work;
+    u8 reset_retries;                   /* FLR attempts deferred on -EAGAIN */
+    u8 reset_attempts;                  /* Failed bring-ups this recovery */
     struct work_struct init_work;
 
-    /* Spinlock for device access */
+    /* Runtime power management */
+    struct mt7927_pm pm;
+    struct mt7927_link_pm link_pm;
+
+    /* mac80211 */
+    u8 macaddr[ETH_ALEN];
+    struct mt7927_nic_cap nic_cap;      /* As reported by the firmware */
+    struct ieee80211_supported_band sband_2g;
+    struct ieee80211_supported_band sband_5g;
+    struct work_struct tx_work;         /* Drains mac80211 TXQs into tx_q[0] */
+    u32 vif_mask;
+    DECLARE_BITMAP(wcid_mask, MT7927_WTBL_SIZE);
+    struct mt7927_sta __rcu *wcid[MT7927_WTBL_SIZE];
+    struct mt7927_amsdu amsdu;
+
+    struct dentry *debugfs_dir;
+
+    /* Serializes read-modify-write of the host IRQ enable mask */
     spinlock_t lock;
     struct mutex mutex;
 };
@@ -157,6 +554,10 @@ struct mt7927_dev {
 #define MT7927_STATE_INITIALIZED        BIT(0)
 #define MT7927_STATE_MCU_RUNNING        BIT(1)
 #define MT7927_STATE_RESET              BIT(2)
+#define MT7927_STATE_REMOVING           BIT(3)
+#define MT7927_STATE_SUSPEND            BIT(4)
+#define MT7927_STATE_RUNNING            BIT(5)  /* mac80211 started */
+#define MT7927_STATE_DEAD               BIT(6)  /* Recovery gave up */
 
 /* ============================================
  * Register Access Functions
@@ -369,6 +770,17 @@ static inline bool mt7927_poll(struct mt7927_dev *dev, u32 offset,
     return false;
 }
 
+/**
+ * mt7927_chip_is_dead - Check whether the chip has dropped off the bus
+ *
+ * A surprise link down or a wedged chip makes every BAR read return
+ * all-ones (the state `make check` reports as "error state").
+ */
+static inline bool mt7927_chip_is_dead(struct mt7927_dev *dev)
+{
+    return mt7927_rr_raw(dev, MT_HW_CHIPID) == ~0U;
+}
+
 /* ============================================
  * Function Declarations
  * ============================================ */
@@ -377,15 +789,31 @@ static inline bool mt7927_poll(struct mt7927_dev *dev, u32 offset,
 int mt7927_mcu_fw_pmctrl(struct mt7927_dev *dev);
 int mt7927_mcu_drv_pmctrl(struct mt7927_dev *dev);
 
+/* Runtime power management (mt7927_pm.c) */
+void mt7927_pm_init(struct mt7927_dev *dev);
+void mt7927_pm_start(struct mt7927_dev *dev);
+void mt7927_pm_stop(struct mt7927_dev *dev);
+void mt7927_pm_set_enable(struct mt7927_dev *dev, bool enable);
+int mt7927_pm_get(struct mt7927_dev *dev);
+void mt7927_pm_put(struct mt7927_dev *dev);
+bool mt7927_pm_ref(struct mt7927_dev *dev);
+void mt7927_pm_queue_skb(struct mt7927_dev *dev, struct sk_buff *skb);
+void mt7927_link_pm_hint(struct mt7927_dev *dev);
+void mt7927_link_pm_set_enable(struct mt7927_dev *dev, bool enable);
+
 /* WiFi system reset (mt7927_pci.c) */
 int mt7927_wfsys_reset(struct mt7927_dev *dev);
 int mt7927_wpdma_reset(struct mt7927_dev *dev, bool force);
+void mt7927_reset(struct mt7927_dev *dev);
 
 /* DMA (mt7927_dma.c) */
 int mt7927_dma_init(struct mt7927_dev *dev);
 void mt7927_dma_cleanup(struct mt7927_dev *dev);
 int mt7927_dma_enable(struct mt7927_dev *dev);
 int mt7927_dma_disable(struct mt7927_dev *dev, bool force);
+int mt7927_dma_suspend(struct mt7927_dev *dev);
+int mt7927_dma_resume(struct mt7927_dev *dev);
+int mt7927_dma_reset(struct mt7927_dev *dev);
 
 int mt7927_queue_alloc(struct mt7927_dev *dev, struct mt7927_queue *q,
                        int idx, int ndesc, int buf_size, u32 ring_base);
@@ -393,22 +821,54 @@ void mt7927_queue_free(struct mt7927_dev *dev, struct mt7927_queue *q);
 
 int mt7927_tx_queue_skb(struct mt7927_dev *dev, struct mt7927_queue *q,
                         struct sk_buff *skb);
+int mt7927_tx_queue_skb_frag(struct mt7927_dev *dev, struct mt7927_queue *q,
+                             struct sk_buff *skb, dma_addr_t frag, u32 frag_len);
+int mt7927_tx_queue_txwi(struct mt7927_dev *dev, struct mt7927_queue *q,
+                         struct mt7927_txwi *txwi, struct sk_buff *skb);
+struct mt7927_txwi *mt7927_txwi_get(struct mt7927_dev *dev);
+void mt7927_txwi_put(struct mt7927_dev *dev, struct mt7927_txwi *txwi);
 void mt7927_tx_complete(struct mt7927_dev *dev, struct mt7927_queue *q);
+int mt7927_tx_wait_idle(struct mt7927_dev *dev, struct mt7927_queue *q,
+                        unsigned long timeout);
+u32 mt7927_compl_begin(struct mt7927_compl *c);
+void mt7927_compl_end(struct mt7927_compl *c, ktime_t start,
+                      enum mt7927_compl_by by);
 int mt7927_rx_poll(struct mt7927_dev *dev, struct mt7927_queue *q, int budget);
 
 /* MCU (mt7927_mcu.c) */
 int mt7927_mcu_init(struct mt7927_dev *dev);
 void mt7927_mcu_exit(struct mt7927_dev *dev);
+void mt7927_mcu_rx_event(struct mt7927_dev *dev, struct sk_buff *skb);
+int mt7927_mcu_event_init(struct mt7927_dev *dev);
+void mt7927_mcu_event_exit(struct mt7927_dev *dev);
+void mt7927_mcu_register_event(struct mt7927_dev *dev, u8 eid,
+                               mt7927_mcu_event_fn handler);
+void mt7927_mcu_tx_done(struct mt7927_dev *dev, struct sk_buff *skb);
 int mt7927_mcu_send_msg(struct mt7927_dev *dev, int cmd,
                         const void *data, int len, bool wait_resp);
 int mt7927_mcu_send_and_get_msg(struct mt7927_dev *dev, int cmd,
                                 const void *data, int len,
                                 bool wait_resp, struct sk_buff **ret_skb);
+int mt7927_mcu_query_cached(struct mt7927_dev *dev, int cmd,
+                            const void *data, int len,
+                            struct sk_buff **ret_skb);
+void mt7927_mcu_cache_flush(struct mt7927_dev *dev);
+int mt7927_mcu_get_nic_capability(struct mt7927_dev *dev);
+int mt7927_mcu_add_dev(struct mt7927_dev *dev, struct ieee80211_vif *vif,
+                       bool enable);
+int mt7927_mcu_sta_update(struct mt7927_dev *dev, struct ieee80211_vif *vif,
+                          struct ieee80211_sta *sta, bool enable,
+                          u8 conn_state);
+int mt7927_mcu_sta_update_hdr_trans(struct mt7927_dev *dev,
+                                    struct ieee80211_vif *vif,
+                                    struct ieee80211_sta *sta);
+void mt7927_fw_crc_free(struct mt7927_fw_crc *ref);
 
 /* Firmware loading (mt7927_mcu.c) */
 int mt7927_load_firmware(struct mt7927_dev *dev);
 int mt7927_load_patch(struct mt7927_dev *dev);
 int mt7927_load_ram(struct mt7927_dev *dev);
+int mt7927_fw_plan_show(struct mt7927_dev *dev, struct seq_file *s);
 
 /* IRQ handling (mt7927_pci.c) */
 irqreturn_t mt7927_irq_handler(int irq, void *dev_instance);
@@ -416,8 +876,25 @@ void mt7927_irq_tasklet(unsigned long data);
 void mt7927_irq_enable(struct mt7927_dev *dev, u32 mask);
 void mt7927_irq_disable(struct mt7927_dev *dev, u32 mask);
 
-/* Device registration (mt7927_pci.c) */
+/* Debugfs (mt7927_debugfs.c) */
+void mt7927_init_debugfs(struct mt7927_dev *dev);
+void mt7927_exit_debugfs(struct mt7927_dev *dev);
+
+/* Device registration and mac80211 ops (mt7927_main.c) */
+struct mt7927_dev *mt7927_alloc_device(struct pci_dev *pdev);
 int mt7927_register_device(struct mt7927_dev *dev);
 void mt7927_unregister_device(struct mt7927_dev *dev);
+void mt7927_tx_kick(struct mt7927_dev *dev);
+void mt7927_set_amsdu_max_len(struct mt7927_dev *dev, u32 len);
+
+/* Data path (mt7927_mac.c) */
+int mt7927_mac_tx(struct mt7927_dev *dev, struct ieee80211_vif *vif,
+                  struct ieee80211_sta *sta, struct sk_buff *skb);
+void mt7927_mac_tx_done(struct mt7927_dev *dev, struct sk_buff_head *list,
+                        int budget);
+void mt7927_mac_tx_drop(struct mt7927_dev *dev, struct sk_buff *skb);
+int mt7927_mac_tx_queue(struct mt7927_dev *dev, struct sk_buff *skb);
+void mt7927_mac_sta_txd_init(struct mt7927_dev *dev, struct ieee80211_sta *sta);
+void mt7927_mac_rx_list(struct mt7927_dev *dev, struct sk_buff_head *frames);
 
 #endif /* __MT7927_H */
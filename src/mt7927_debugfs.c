@@ -0,0 +1,509 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * MT7927 WiFi 7 Linux Driver - Debugfs
+ *
+ * Runtime statistics and tunables under /sys/kernel/debug/mt7927-<pci>/
+ *
+ * Copyright (C) 2024 MT7927 Linux Driver Project
+ */
+
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "mt7927.h"
+
+/* ============================================
+ * Runtime Power Management
+ * ============================================ */
+
+static int mt7927_pm_set(void *data, u64 val)
+{
+    struct mt7927_dev *dev = data;
+
+    mt7927_pm_set_enable(dev, !!val);
+
+    return 0;
+}
+
+static int mt7927_pm_get_enable(void *data, u64 *val)
+{
+    struct mt7927_dev *dev = data;
+
+    *val = dev->pm.enable;
+
+    return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(fops_pm, mt7927_pm_get_enable, mt7927_pm_set, "%lld\n");
+
+static int mt7927_pm_idle_timeout_set(void *data, u64 val)
+{
+    struct mt7927_dev *dev = data;
+
+    dev->pm.idle_timeout = msecs_to_jiffies(val);
+
+    return 0;
+}
+
+static int mt7927_pm_idle_timeout_get(void *data, u64 *val)
+{
+    struct mt7927_dev *dev = data;
+
+    *val = jiffies_to_msecs(dev->pm.idle_timeout);
+
+    return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(fops_pm_idle_timeout, mt7927_pm_idle_timeout_get,
+                         mt7927_pm_idle_timeout_set, "%lld\n");
+
+static int mt7927_pm_stats_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+    struct mt7927_pm_stats *stats = &dev->pm.stats;
+    unsigned long now = jiffies;
+    unsigned long doze = stats->doze_time, awake = stats->awake_time;
+
+    if (dev->pm.fw_own)
+        doze += now - stats->last_change;
+    else
+        awake += now - stats->last_change;
+
+    seq_printf(s, "owner:\t\t%s\n", dev->pm.fw_own ? "firmware" : "driver");
+    seq_printf(s, "awake time:\t%u ms\n", jiffies_to_msecs(awake));
+    seq_printf(s, "doze time:\t%u ms\n", jiffies_to_msecs(doze));
+    seq_printf(s, "doze count:\t%u\n", stats->doze_count);
+    seq_printf(s, "wake count:\t%u\n", stats->wake_count);
+    seq_printf(s, "wake latency:\tlast %u us, max %u us, avg %llu us\n",
+               stats->wake_lat_last_us, stats->wake_lat_max_us,
+               stats->wake_count ?
+               div_u64(stats->wake_lat_total_us, stats->wake_count) : 0);
+
+    return 0;
+}
+
+/* ============================================
+ * Link (ASPM) Power Policy
+ * ============================================ */
+
+static int mt7927_link_pm_set(void *data, u64 val)
+{
+    struct mt7927_dev *dev = data;
+
+    mt7927_link_pm_set_enable(dev, !!val);
+
+    return 0;
+}
+
+static int mt7927_link_pm_get(void *data, u64 *val)
+{
+    struct mt7927_dev *dev = data;
+
+    *val = dev->link_pm.enable;
+
+    return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(fops_link_pm, mt7927_link_pm_get, mt7927_link_pm_set,
+                         "%lld\n");
+
+static int mt7927_link_pm_stats_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+    struct mt7927_link_pm *lp = &dev->link_pm;
+    unsigned long time[__MT7927_LINK_PM_MAX];
+
+    memcpy(time, lp->time, sizeof(time));
+    time[lp->state] += jiffies - lp->last_change;
+
+    seq_printf(s, "state:\t\t\t%s\n",
+               lp->state == MT7927_LINK_PM_PERF ? "performance (ASPM off)" :
+                                                  "low power (ASPM on)");
+    seq_printf(s, "low power time:\t\t%u ms\n",
+               jiffies_to_msecs(time[MT7927_LINK_PM_LOW_POWER]));
+    seq_printf(s, "performance time:\t%u ms\n",
+               jiffies_to_msecs(time[MT7927_LINK_PM_PERF]));
+    seq_printf(s, "transitions:\t\t%u\n", lp->transitions);
+
+    return 0;
+}
+
+/* ============================================
+ * MCU Events
+ * ============================================ */
+
+static int mt7927_mcu_events_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+    int i;
+
+    seq_printf(s, "backlog:\t%u (max %u)\n",
+               skb_queue_len(&dev->mcu.event_q), dev->mcu.event_backlog_max);
+    seq_printf(s, "unhandled:\t%u\n", dev->mcu.event_unhandled);
+    seq_puts(s, "eid\tcount\thandler\n");
+
+    for (i = 0; i < MT7927_MCU_EVENT_NUM; i++) {
+        struct mt7927_mcu_event *ev = &dev->mcu.events[i];
+
+        if (!ev->count && !ev->handler)
+            continue;
+
+        seq_printf(s, "0x%02x\t%u\t%ps\n", i, ev->count, ev->handler);
+    }
+
+    return 0;
+}
+
+static int mt7927_mcu_cache_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+    struct mt7927_mcu_cache *cache = &dev->fw_cache;
+    struct mt7927_mcu_cache_entry *e;
+    int n = 0;
+
+    mutex_lock(&cache->lock);
+    list_for_each_entry(e, &cache->entries, list)
+        n++;
+
+    seq_printf(s, "firmware:\t%.10s (%.15s), patch %.16s, hw rev 0x%02x\n",
+               cache->ident.ram_ver, cache->ident.ram_build,
+               cache->ident.patch_build, cache->ident.hw_rev);
+    seq_printf(s, "valid:\t\t%d\n", cache->valid);
+    seq_printf(s, "entries:\t%d\n", n);
+    seq_printf(s, "hits:\t\t%u\n", cache->hits);
+    seq_printf(s, "misses:\t\t%u\n", cache->misses);
+    seq_printf(s, "flushes:\t%u\n", cache->flushes);
+    mutex_unlock(&cache->lock);
+
+    return 0;
+}
+
+/* ============================================
+ * MCU Latency
+ * ============================================ */
+
+static const char * const mt7927_mcu_lat_names[] = {
+    [MT7927_MCU_LAT_DMA] = "dma",
+    [MT7927_MCU_LAT_RESP] = "resp",
+};
+
+static int mt7927_mcu_latency_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+    struct mt7927_mcu_lat_slot sum;
+    u32 untracked = 0;
+    int cpu, i, t, b;
+    u32 key;
+
+    for_each_possible_cpu(cpu)
+        untracked += per_cpu_ptr(dev->mcu.lat, cpu)->untracked;
+
+    seq_printf(s, "seq mismatch:\t%u\n", dev->mcu.seq_mismatch);
+    seq_printf(s, "untracked:\t%u\n", untracked);
+    seq_puts(s, "cmd\t\ttype\ttimeouts\tlatency (< us: count)\n");
+
+    for (i = 0; i < MT7927_MCU_LAT_SLOTS; i++) {
+        key = READ_ONCE(dev->mcu.lat_key[i]);
+        if (!key)
+            break;
+
+        memset(&sum, 0, sizeof(sum));
+        for_each_possible_cpu(cpu) {
+            struct mt7927_mcu_lat_slot *slot;
+
+            slot = &per_cpu_ptr(dev->mcu.lat, cpu)->slot[i];
+            for (t = 0; t < __MT7927_MCU_LAT_MAX; t++)
+                for (b = 0; b < MT7927_MCU_LAT_BUCKETS; b++)
+                    sum.hist[t][b] += slot->hist[t][b];
+            sum.timeouts += slot->timeouts;
+        }
+
+        for (t = 0; t < __MT7927_MCU_LAT_MAX; t++) {
+            seq_printf(s, "0x%06x\t%s\t%u\t\t",
+                       key & ~MT7927_MCU_LAT_KEY_VALID,
+                       mt7927_mcu_lat_names[t], sum.timeouts);
+
+            for (b = 0; b < MT7927_MCU_LAT_BUCKETS; b++) {
+                if (!sum.hist[t][b])
+                    continue;
+                if (b == MT7927_MCU_LAT_BUCKETS - 1)
+                    seq_printf(s, " inf:%u", sum.hist[t][b]);
+                else
+                    seq_printf(s, " %lu:%u", BIT(b), sum.hist[t][b]);
+            }
+            seq_putc(s, '\n');
+        }
+    }
+
+    return 0;
+}
+
+/* ============================================
+ * Firmware Download Plan
+ * ============================================ */
+
+static int mt7927_fw_plan_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+
+    return mt7927_fw_plan_show(dev, s);
+}
+
+/* ============================================
+ * Ring Completion Mode
+ * ============================================ */
+
+static const char * const mt7927_compl_names[] = {
+    [MT7927_COMPL_IRQ] = "irq",
+    [MT7927_COMPL_HYBRID] = "hybrid",
+    [MT7927_COMPL_POLL] = "poll",
+};
+
+static int mt7927_compl_mode_set(void *data, u64 val)
+{
+    struct mt7927_queue *q = data;
+
+    if (val >= __MT7927_COMPL_MAX)
+        return -EINVAL;
+
+    WRITE_ONCE(q->compl.mode, val);
+
+    return 0;
+}
+
+static int mt7927_compl_mode_get(void *data, u64 *val)
+{
+    struct mt7927_queue *q = data;
+
+    *val = q->compl.mode;
+
+    return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(fops_compl_mode, mt7927_compl_mode_get,
+                         mt7927_compl_mode_set, "%lld\n");
+
+static void mt7927_compl_show(struct seq_file *s, const char *name,
+                              struct mt7927_queue *q)
+{
+    struct mt7927_compl *c = &q->compl;
+
+    seq_printf(s, "%s:\tmode %s, waits %u, polled %u, irq %u, timeouts %u, avg %lu us\n",
+               name, mt7927_compl_names[c->mode], c->waits, c->polled,
+               c->irq, c->timeouts, ewma_compl_lat_read(&c->lat_us));
+}
+
+static int mt7927_compl_stats_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+
+    if (dev->q_mcu[MT_MCUQ_FWDL])
+        mt7927_compl_show(s, "fwdl", dev->q_mcu[MT_MCUQ_FWDL]);
+    mt7927_compl_show(s, "mcu", &dev->rx_q[MT7927_RXQ_MCU_WM]);
+
+    return 0;
+}
+
+/* ============================================
+ * RX Copybreak
+ * ============================================ */
+
+static int mt7927_rx_copybreak_set(void *data, u64 val)
+{
+    struct mt7927_dev *dev = data;
+
+    if (val > MT_RX_BUF_SIZE)
+        return -EINVAL;
+
+    WRITE_ONCE(dev->rx_copybreak, val);
+
+    return 0;
+}
+
+static int mt7927_rx_copybreak_get(void *data, u64 *val)
+{
+    struct mt7927_dev *dev = data;
+
+    *val = dev->rx_copybreak;
+
+    return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(fops_rx_copybreak, mt7927_rx_copybreak_get,
+                         mt7927_rx_copybreak_set, "%lld\n");
+
+/* ============================================
+ * TX Flow Control
+ * ============================================ */
+
+static int mt7927_tx_flow_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+    struct mt7927_queue *q = &dev->tx_q[0];
+    unsigned long flags;
+    int used;
+
+    spin_lock_irqsave(&q->lock, flags);
+    used = q->head - q->tail;
+    if (used < 0)
+        used += q->ndesc;
+
+    seq_printf(s, "state:\t\t%s\n", q->stopped ? "stopped" : "running");
+    seq_printf(s, "stops:\t\t%u\n", q->stops);
+    seq_printf(s, "descriptors:\t%d / %d\n", used, q->ndesc);
+    seq_printf(s, "bytes queued:\t%u\n", q->dql.num_queued - q->dql.num_completed);
+    seq_printf(s, "byte limit:\t%u (max %u)\n", q->dql.limit, q->dql.max_limit);
+    spin_unlock_irqrestore(&q->lock, flags);
+
+    return 0;
+}
+
+/* ============================================
+ * TX A-MSDU
+ * ============================================ */
+
+static int mt7927_amsdu_set(void *data, u64 val)
+{
+    struct mt7927_dev *dev = data;
+
+    /* Takes effect when an interface is next brought up */
+    WRITE_ONCE(dev->amsdu.enable, !!val);
+
+    return 0;
+}
+
+static int mt7927_amsdu_get(void *data, u64 *val)
+{
+    struct mt7927_dev *dev = data;
+
+    *val = dev->amsdu.enable;
+
+    return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(fops_amsdu, mt7927_amsdu_get, mt7927_amsdu_set,
+                         "%lld\n");
+
+static int mt7927_amsdu_max_len_set(void *data, u64 val)
+{
+    struct mt7927_dev *dev = data;
+
+    if (val > IEEE80211_MAX_MPDU_LEN_VHT_11454)
+        return -EINVAL;
+
+    mt7927_set_amsdu_max_len(dev, val);
+
+    return 0;
+}
+
+static int mt7927_amsdu_max_len_get(void *data, u64 *val)
+{
+    struct mt7927_dev *dev = data;
+
+    *val = dev->amsdu.max_len;
+
+    return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(fops_amsdu_max_len, mt7927_amsdu_max_len_get,
+                         mt7927_amsdu_max_len_set, "%lld\n");
+
+static int mt7927_amsdu_subframes_set(void *data, u64 val)
+{
+    struct mt7927_dev *dev = data;
+
+    if (!val || val > MT7927_TX_AMSDU_MAX_SUBFRAMES)
+        return -EINVAL;
+
+    WRITE_ONCE(dev->hw->max_tx_fragments, val);
+
+    return 0;
+}
+
+static int mt7927_amsdu_subframes_get(void *data, u64 *val)
+{
+    struct mt7927_dev *dev = data;
+
+    *val = dev->hw->max_tx_fragments;
+
+    return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(fops_amsdu_subframes, mt7927_amsdu_subframes_get,
+                         mt7927_amsdu_subframes_set, "%lld\n");
+
+static int mt7927_amsdu_stats_read(struct seq_file *s, void *data)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(s->private);
+    u64 frames = 0, msdus = 0;
+    int i;
+
+    for (i = 0; i < MT7927_TX_AMSDU_MAX_SUBFRAMES; i++) {
+        frames += dev->amsdu.hist[i];
+        msdus += (u64)dev->amsdu.hist[i] * (i + 1);
+        seq_printf(s, "%d subframe%s:\t%u\n", i + 1, i ? "s" : "",
+                   dev->amsdu.hist[i]);
+    }
+
+    seq_printf(s, "avg subframes:\t%llu.%02llu\n",
+               frames ? div64_u64(msdus, frames) : 0,
+               frames ? div64_u64(msdus * 100, frames) % 100 : 0);
+
+    return 0;
+}
+
+/* ============================================
+ * Setup / Teardown
+ * ============================================ */
+
+void mt7927_init_debugfs(struct mt7927_dev *dev)
+{
+    char name[32];
+    struct dentry *dir;
+
+    snprintf(name, sizeof(name), "mt7927-%s", pci_name(dev->pdev));
+    dir = debugfs_create_dir(name, NULL);
+    if (IS_ERR(dir))
+        return;
+
+    dev->debugfs_dir = dir;
+
+    debugfs_create_file("runtime-pm", 0600, dir, dev, &fops_pm);
+    debugfs_create_file("runtime-pm-idle-ms", 0600, dir, dev,
+                        &fops_pm_idle_timeout);
+    debugfs_create_devm_seqfile(dev->dev, "runtime-pm-stats", dir,
+                                mt7927_pm_stats_read);
+    debugfs_create_file("link-pm", 0600, dir, dev, &fops_link_pm);
+    debugfs_create_devm_seqfile(dev->dev, "link-pm-stats", dir,
+                                mt7927_link_pm_stats_read);
+    debugfs_create_devm_seqfile(dev->dev, "mcu-events", dir,
+                                mt7927_mcu_events_read);
+    debugfs_create_devm_seqfile(dev->dev, "mcu-latency", dir,
+                                mt7927_mcu_latency_read);
+    debugfs_create_devm_seqfile(dev->dev, "mcu-cache", dir,
+                                mt7927_mcu_cache_read);
+    debugfs_create_file("completion-fwdl", 0600, dir, dev->q_mcu[MT_MCUQ_FWDL],
+                        &fops_compl_mode);
+    debugfs_create_file("completion-mcu", 0600, dir,
+                        &dev->rx_q[MT7927_RXQ_MCU_WM], &fops_compl_mode);
+    debugfs_create_devm_seqfile(dev->dev, "completion-stats", dir,
+                                mt7927_compl_stats_read);
+    debugfs_create_file("rx-copybreak", 0600, dir, dev, &fops_rx_copybreak);
+    debugfs_create_devm_seqfile(dev->dev, "tx-flow", dir,
+                                mt7927_tx_flow_read);
+    debugfs_create_file("tx-amsdu", 0600, dir, dev, &fops_amsdu);
+    debugfs_create_file("tx-amsdu-max-len", 0600, dir, dev,
+                        &fops_amsdu_max_len);
+    debugfs_create_file("tx-amsdu-subframes", 0600, dir, dev,
+                        &fops_amsdu_subframes);
+    debugfs_create_devm_seqfile(dev->dev, "tx-amsdu-stats", dir,
+                                mt7927_amsdu_stats_read);
+    debugfs_create_devm_seqfile(dev->dev, "fw-plan", dir,
+                                mt7927_fw_plan_read);
+}
+
+void mt7927_exit_debugfs(struct mt7927_dev *dev)
+{
+    debugfs_remove_recursive(dev->debugfs_dir);
+    dev->debugfs_dir = NULL;
+}
@@ -7,6 +7,7 @@
  * Copyright (C) 2024 MT7927 Linux Driver Project
  */
 
+#include <linux/module.h>
 #include <linux/skbuff.h>
 #include <linux/netdevice.h>
 #include <linux/dma-mapping.h>
@@ -14,10 +15,357 @@
 
 #include "mt7927.h"
 
+static unsigned int rx_copybreak = 256;
+module_param(rx_copybreak, uint, 0444);
+MODULE_PARM_DESC(rx_copybreak, "Copy RX frames up to this size and keep the DMA buffer posted (default: 256)");
+
 /* ============================================
  * DMA Queue Allocation
  * ============================================ */
 
+/**
+ * mt7927_queue_setup_hw - Program a ring's registers from its host state
+ * @dev: device structure
+ * @q: allocated queue
+ */
+static void mt7927_queue_setup_hw(struct mt7927_dev *dev, struct mt7927_queue *q)
+{
+    u32 readback;
+
+    /*
+     * Configure hardware ring registers
+     * Ring register layout (from mt76_queue_regs):
+     *   offset 0x00: desc_base (32-bit DMA address, low bits)
+     *   offset 0x04: ring_size (descriptor count)
+     *   offset 0x08: cpu_idx
+     *   offset 0x0c: dma_idx
+     *
+     * For 64-bit DMA, high bits are written to EXT_CTRL registers.
+     */
+    dev_info(dev->dev, "Queue %d: writing ring_base=0x%x, dma=0x%llx, ndesc=%d\n",
+             q->hw_idx, q->ring_base, (u64)q->desc_dma, q->ndesc);
+
+    mt7927_wr(dev, q->ring_base + 0x00, lower_32_bits(q->desc_dma));  /* Base (low 32 bits) */
+    mt7927_wr(dev, q->ring_base + 0x04, q->ndesc);                     /* Ring size (count) */
+    mt7927_wr(dev, q->ring_base + 0x08, 0);                            /* CPU index */
+    mt7927_wr(dev, q->ring_base + 0x0c, 0);                            /* DMA index */
+    wmb();  /* Ensure writes are visible to hardware */
+
+    /* Verify the write succeeded */
+    readback = mt7927_rr(dev, q->ring_base);
+    if (readback != lower_32_bits(q->desc_dma)) {
+        dev_warn(dev->dev, "Queue %d: ring base write failed! wrote=0x%x, read=0x%x\n",
+                 q->hw_idx, lower_32_bits(q->desc_dma), readback);
+    }
+}
+
+/* ============================================
+ * RX Buffers
+ * ============================================ */
+
+/*
+ * RX buffers are bare page fragments: build_skb() turns the first
+ * buffer of a frame into the skb head without a copy, so each fragment
+ * carries tail room for the skb_shared_info.
+ */
+static unsigned int mt7927_rx_frag_size(struct mt7927_queue *q)
+{
+    return SKB_DATA_ALIGN(q->buf_size) +
+           SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+}
+
+/**
+ * mt7927_rx_buf_alloc - Allocate and map one RX buffer
+ * @dev: device structure
+ * @q: RX queue
+ * @dma_addr: returns the bus address
+ *
+ * Returns: the buffer, or NULL. Safe in atomic context.
+ */
+static void *mt7927_rx_buf_alloc(struct mt7927_dev *dev, struct mt7927_queue *q,
+                                 dma_addr_t *dma_addr)
+{
+    void *buf;
+
+    buf = netdev_alloc_frag(mt7927_rx_frag_size(q));
+    if (!buf)
+        return NULL;
+
+    *dma_addr = dma_map_single(dev->dev, buf, q->buf_size, DMA_FROM_DEVICE);
+    if (dma_mapping_error(dev->dev, *dma_addr)) {
+        skb_free_frag(buf);
+        return NULL;
+    }
+
+    return buf;
+}
+
+/**
+ * mt7927_rx_buf_post - Hand an RX buffer to the descriptor at @idx
+ */
+static void mt7927_rx_buf_post(struct mt7927_queue *q, int idx, void *buf,
+                               dma_addr_t dma_addr)
+{
+    struct mt7927_desc *desc = &q->desc[idx];
+
+    q->buf[idx] = buf;
+    q->dma_addr[idx] = dma_addr;
+
+    desc->buf0 = cpu_to_le32(lower_32_bits(dma_addr));
+    desc->buf1 = cpu_to_le32(upper_32_bits(dma_addr));
+    desc->ctrl = cpu_to_le32(q->buf_size);
+}
+
+/**
+ * mt7927_rx_buf_free - Unmap and release every RX buffer of a queue
+ */
+static void mt7927_rx_buf_free(struct mt7927_dev *dev, struct mt7927_queue *q)
+{
+    int i;
+
+    for (i = 0; i < q->ndesc; i++) {
+        if (!q->buf[i])
+            continue;
+
+        dma_unmap_single(dev->dev, q->dma_addr[i], q->buf_size,
+                         DMA_FROM_DEVICE);
+        skb_free_frag(q->buf[i]);
+        q->buf[i] = NULL;
+    }
+
+    dev_kfree_skb_any(q->rx_head);
+    q->rx_head = NULL;
+    q->rx_discard = false;
+}
+
+/**
+ * mt7927_rx_buf_copy - Copy a small frame out of the RX buffer at @idx
+ *
+ * The buffer stays mapped and posted; only the received bytes are synced
+ * to the CPU and back, so no allocation or IOMMU work is spent on it.
+ * Returns: a right-sized skb, or NULL.
+ */
+static struct sk_buff *mt7927_rx_buf_copy(struct mt7927_dev *dev,
+                                          struct mt7927_queue *q, int idx,
+                                          int len)
+{
+    struct sk_buff *skb;
+
+    skb = dev_alloc_skb(len);
+    if (!skb)
+        return NULL;
+
+    dma_sync_single_for_cpu(dev->dev, q->dma_addr[idx], len, DMA_FROM_DEVICE);
+    skb_put_data(skb, q->buf[idx], len);
+    dma_sync_single_for_device(dev->dev, q->dma_addr[idx], len,
+                               DMA_FROM_DEVICE);
+
+    return skb;
+}
+
+/* ============================================
+ * TXWI Cache
+ * ============================================ */
+
+/*
+ * Data frames carry their TXD in a small coherent buffer that the ring
+ * DMAs as segment 0, with the skb as segment 1. The skb is never pushed
+ * into or reallocated for headroom, and a freed TXD goes to the front of
+ * the list so the next frame writes memory that is still cache-hot.
+ */
+static int mt7927_txwi_init(struct mt7927_dev *dev)
+{
+    struct mt7927_txwi_cache *c = &dev->txwi;
+    int i;
+
+    spin_lock_init(&c->lock);
+    INIT_LIST_HEAD(&c->free);
+
+    c->ent = kcalloc(MT7927_TXWI_NUM, sizeof(*c->ent), GFP_KERNEL);
+    if (!c->ent)
+        return -ENOMEM;
+
+    c->buf = dma_alloc_coherent(dev->dev, MT7927_TXWI_NUM * MT_TXD_SIZE,
+                                &c->dma, GFP_KERNEL);
+    if (!c->buf) {
+        kfree(c->ent);
+        c->ent = NULL;
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < MT7927_TXWI_NUM; i++) {
+        struct mt7927_txwi *t = &c->ent[i];
+
+        t->txd = c->buf + i * MT_TXD_SIZE;
+        t->dma = c->dma + i * MT_TXD_SIZE;
+        list_add_tail(&t->list, &c->free);
+    }
+
+    return 0;
+}
+
+static void mt7927_txwi_exit(struct mt7927_dev *dev)
+{
+    struct mt7927_txwi_cache *c = &dev->txwi;
+
+    if (!c->buf)
+        return;
+
+    dma_free_coherent(dev->dev, MT7927_TXWI_NUM * MT_TXD_SIZE, c->buf,
+                      c->dma);
+    kfree(c->ent);
+    c->buf = NULL;
+    c->ent = NULL;
+}
+
+/**
+ * mt7927_txwi_get - Take a TXD buffer for a data frame
+ *
+ * Returns: NULL if every TXD is in flight.
+ */
+struct mt7927_txwi *mt7927_txwi_get(struct mt7927_dev *dev)
+{
+    struct mt7927_txwi_cache *c = &dev->txwi;
+    struct mt7927_txwi *t;
+
+    spin_lock_bh(&c->lock);
+    t = list_first_entry_or_null(&c->free, struct mt7927_txwi, list);
+    if (t)
+        list_del(&t->list);
+    spin_unlock_bh(&c->lock);
+
+    return t;
+}
+
+void mt7927_txwi_put(struct mt7927_dev *dev, struct mt7927_txwi *txwi)
+{
+    struct mt7927_txwi_cache *c = &dev->txwi;
+
+    spin_lock_bh(&c->lock);
+    list_add(&txwi->list, &c->free);
+    spin_unlock_bh(&c->lock);
+}
+
+/* ============================================
+ * TX Bounce Pool
+ * ============================================ */
+
+/*
+ * Each TX ring keeps a coherent block of MT7927_TX_BOUNCE_SIZE slots
+ * that stay mapped for the ring's lifetime. Small frames are copied into
+ * a slot instead of being mapped, which saves an IOMMU map/unmap (and
+ * IOTLB flush) per packet. A descriptor's slot is recovered from its
+ * bus address, so no per-descriptor bookkeeping is needed.
+ */
+
+/**
+ * mt7927_tx_bounce_alloc - Allocate the bounce pool of a TX ring
+ *
+ * Failure is not fatal; the ring then maps every frame.
+ */
+static void mt7927_tx_bounce_alloc(struct mt7927_dev *dev,
+                                   struct mt7927_queue *q)
+{
+    int i, n = min(q->ndesc, MT7927_TX_BOUNCE_SLOTS);
+
+    q->bounce.free = kcalloc(n, sizeof(*q->bounce.free), GFP_KERNEL);
+    if (!q->bounce.free)
+        goto err;
+
+    q->bounce.buf = dma_alloc_coherent(dev->dev, n * MT7927_TX_BOUNCE_SIZE,
+                                       &q->bounce.dma, GFP_KERNEL);
+    if (!q->bounce.buf) {
+        kfree(q->bounce.free);
+        q->bounce.free = NULL;
+        goto err;
+    }
+
+    for (i = 0; i < n; i++)
+        q->bounce.free[i] = i;
+    q->bounce.nslots = n;
+    q->bounce.nfree = n;
+
+    return;
+
+err:
+    dev_warn(dev->dev, "No TX bounce pool for queue %d\n", q->hw_idx);
+}
+
+static void mt7927_tx_bounce_free(struct mt7927_dev *dev,
+                                  struct mt7927_queue *q)
+{
+    if (!q->bounce.buf)
+        return;
+
+    dma_free_coherent(dev->dev, q->bounce.nslots * MT7927_TX_BOUNCE_SIZE,
+                      q->bounce.buf, q->bounce.dma);
+    kfree(q->bounce.free);
+    memset(&q->bounce, 0, sizeof(q->bounce));
+}
+
+/**
+ * mt7927_tx_bounce_get - Copy a small frame into a free slot
+ * @q: TX queue, lock held
+ * @skb: frame
+ * @dma_addr: returns the slot's bus address
+ *
+ * Returns: false if the frame is too large or the pool is exhausted.
+ */
+static bool mt7927_tx_bounce_get(struct mt7927_queue *q, struct sk_buff *skb,
+                                 dma_addr_t *dma_addr)
+{
+    int slot;
+
+    if (skb->len > MT7927_TX_BOUNCE_SIZE || !q->bounce.nfree)
+        return false;
+
+    slot = q->bounce.free[--q->bounce.nfree];
+    skb_copy_bits(skb, 0, q->bounce.buf + slot * MT7927_TX_BOUNCE_SIZE,
+                  skb->len);
+    *dma_addr = q->bounce.dma + slot * MT7927_TX_BOUNCE_SIZE;
+
+    return true;
+}
+
+/* Whether @addr lies in the bounce pool of @q */
+static bool mt7927_tx_bounced(struct mt7927_queue *q, dma_addr_t addr)
+{
+    return q->bounce.buf && addr >= q->bounce.dma &&
+           addr < q->bounce.dma + q->bounce.nslots * MT7927_TX_BOUNCE_SIZE;
+}
+
+/**
+ * mt7927_tx_release - Return a bounce slot to the pool, or unmap a buffer
+ *
+ * Called with the queue lock held.
+ */
+static void mt7927_tx_release(struct mt7927_dev *dev, struct mt7927_queue *q,
+                              dma_addr_t addr, u32 len)
+{
+    if (mt7927_tx_bounced(q, addr))
+        q->bounce.free[q->bounce.nfree++] =
+            (addr - q->bounce.dma) / MT7927_TX_BOUNCE_SIZE;
+    else
+        dma_unmap_single(dev->dev, addr, len, DMA_TO_DEVICE);
+}
+
+/**
+ * mt7927_tx_unmap - Release the buffers of the TX descriptor at @idx
+ */
+static void mt7927_tx_unmap(struct mt7927_dev *dev, struct mt7927_queue *q,
+                            int idx)
+{
+    struct mt7927_tx_map *map = &q->map[idx];
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(map->len); i++) {
+        if (map->len[i])
+            mt7927_tx_release(dev, q, map->addr[i], map->len[i]);
+    }
+
+    memset(map, 0, sizeof(*map));
+}
+
 /**
  * mt7927_queue_alloc - Allocate a DMA queue
  * @dev: device structure
@@ -33,11 +381,18 @@ int mt7927_queue_alloc(struct mt7927_dev *dev, struct mt7927_queue *q,
     int i, size;
 
     spin_lock_init(&q->lock);
+    spin_lock_init(&q->cleanup_lock);
+    init_waitqueue_head(&q->wait);
+    q->compl.mode = MT7927_COMPL_HYBRID;
+    ewma_compl_lat_init(&q->compl.lat_us);
     q->hw_idx = idx;
     q->ndesc = ndesc;
+    q->buf_size = buf_size;
+    q->ring_base = ring_base;
     q->head = 0;
     q->tail = 0;
     q->stopped = false;
+    dql_init(&q->dql, HZ);
 
     /* Allocate descriptor ring */
     size = ndesc * sizeof(struct mt7927_desc);
@@ -64,235 +419,693 @@ int mt7927_queue_alloc(struct mt7927_dev *dev, struct mt7927_queue *q,
 
     /* For RX queues, pre-allocate buffers */
     if (buf_size > 0) {
+        q->buf = kcalloc(ndesc, sizeof(*q->buf), GFP_KERNEL);
+        if (!q->buf)
+            goto err_free_dma_addr;
+
         for (i = 0; i < ndesc; i++) {
-            struct sk_buff *skb;
             dma_addr_t dma_addr;
+            void *buf;
 
-            skb = dev_alloc_skb(buf_size);
-            if (!skb) {
+            buf = mt7927_rx_buf_alloc(dev, q, &dma_addr);
+            if (!buf) {
                 dev_err(dev->dev, "Failed to allocate RX buffer %d\n", i);
                 goto err_free_buffers;
             }
 
-            dma_addr = dma_map_single(dev->dev, skb->data, buf_size,
-                                      DMA_FROM_DEVICE);
-            if (dma_mapping_error(dev->dev, dma_addr)) {
-                dev_kfree_skb(skb);
-                dev_err(dev->dev, "Failed to map RX buffer %d\n", i);
-                goto err_free_buffers;
-            }
+            mt7927_rx_buf_post(q, i, buf, dma_addr);
+        }
+    } else {
+        q->map = kcalloc(ndesc, sizeof(*q->map), GFP_KERNEL);
+        if (!q->map)
+            goto err_free_dma_addr;
+
+        mt7927_tx_bounce_alloc(dev, q);
+    }
+
+    mt7927_queue_setup_hw(dev, q);
+
+    dev_dbg(dev->dev, "Queue %d allocated: %d descriptors at 0x%llx\n",
+            idx, ndesc, (u64)q->desc_dma);
+
+    return 0;
+
+err_free_buffers:
+    mt7927_rx_buf_free(dev, q);
+    kfree(q->buf);
+    q->buf = NULL;
+err_free_dma_addr:
+    kfree(q->dma_addr);
+err_free_skb:
+    kfree(q->skb);
+err_free_desc:
+    dma_free_coherent(dev->dev, size, q->desc, q->desc_dma);
+    return -ENOMEM;
+}
+
+/**
+ * mt7927_queue_free - Free a DMA queue
+ */
+void mt7927_queue_free(struct mt7927_dev *dev, struct mt7927_queue *q)
+{
+    int i;
+
+    if (!q->desc)
+        return;
+
+    if (q->buf) {
+        mt7927_rx_buf_free(dev, q);
+        kfree(q->buf);
+    }
+
+    /* Free any remaining SKBs and DMA mappings */
+    for (i = 0; i < q->ndesc; i++) {
+        if (q->map)
+            mt7927_tx_unmap(dev, q, i);
+        if (q->skb && q->skb[i])
+            dev_kfree_skb(q->skb[i]);
+    }
+
+    mt7927_tx_bounce_free(dev, q);
+    kfree(q->map);
+
+    kfree(q->dma_addr);
+    kfree(q->skb);
+
+    dma_free_coherent(dev->dev, q->ndesc * sizeof(struct mt7927_desc),
+                      q->desc, q->desc_dma);
+
+    memset(q, 0, sizeof(*q));
+}
+
+/**
+ * mt7927_queue_reset - Return a retained queue to its post-allocation state
+ *
+ * In-flight TX buffers are dropped, RX buffers stay mapped and are handed
+ * back to hardware, and the ring registers are rewritten. Used when the
+ * chip lost its DMA state but the host-side rings are still valid.
+ */
+static void mt7927_queue_reset(struct mt7927_dev *dev, struct mt7927_queue *q)
+{
+    struct sk_buff_head dropped;
+    struct sk_buff *skb;
+    unsigned long flags;
+    int i;
+
+    if (!q->desc)
+        return;
+
+    __skb_queue_head_init(&dropped);
+
+    /* Keep a reaper from walking the ring while it is rewritten */
+    spin_lock_bh(&q->cleanup_lock);
+    spin_lock_irqsave(&q->lock, flags);
 
-            q->skb[i] = skb;
-            q->dma_addr[i] = dma_addr;
+    if (q->rx_head)
+        __skb_queue_tail(&dropped, q->rx_head);
+    q->rx_head = NULL;
+    q->rx_discard = false;
 
-            /* Set up descriptor */
-            q->desc[i].buf0 = cpu_to_le32(lower_32_bits(dma_addr));
-            q->desc[i].buf1 = cpu_to_le32(upper_32_bits(dma_addr));
-            q->desc[i].ctrl = cpu_to_le32(buf_size);
+    for (i = 0; i < q->ndesc; i++) {
+        if (q->buf_size) {
+            q->desc[i].ctrl = cpu_to_le32(q->buf_size);
+            continue;
+        }
+
+        mt7927_tx_unmap(dev, q, i);
+        if (q->skb[i]) {
+            if (q == &dev->tx_q[0])
+                __skb_queue_tail(&dropped, q->skb[i]);
+            else
+                dev_kfree_skb_any(q->skb[i]);
+            q->skb[i] = NULL;
         }
+        q->desc[i].ctrl = 0;
+    }
+
+    q->head = 0;
+    q->tail = 0;
+    q->stopped = false;
+    dql_reset(&q->dql);
+
+    spin_unlock_irqrestore(&q->lock, flags);
+    spin_unlock_bh(&q->cleanup_lock);
+
+    /* Data frames carry AQL/status state that mac80211 must release */
+    while ((skb = __skb_dequeue(&dropped)) != NULL) {
+        if (q->buf_size)
+            dev_kfree_skb_any(skb);
+        else
+            mt7927_mac_tx_drop(dev, skb);
     }
 
+    mt7927_queue_setup_hw(dev, q);
+}
+
+/**
+ * mt7927_queue_verify - Check that hardware still holds our ring state
+ *
+ * Returns: true if base, size and CPU index match the host copy and, for
+ * TX rings, the DMA index has caught up with everything we queued.
+ */
+static bool mt7927_queue_verify(struct mt7927_dev *dev, struct mt7927_queue *q)
+{
+    u32 base, cnt, cidx, didx;
+    int cpu_idx;
+
+    if (!q->desc)
+        return true;
+
+    base = mt7927_rr(dev, q->ring_base + 0x00);
+    cnt = mt7927_rr(dev, q->ring_base + 0x04);
+    cidx = mt7927_rr(dev, q->ring_base + 0x08);
+    didx = mt7927_rr(dev, q->ring_base + 0x0c);
+    cpu_idx = q->buf_size ? q->tail : q->head;
+
+    if (base != lower_32_bits(q->desc_dma) || cnt != q->ndesc ||
+        cidx != cpu_idx || (!q->buf_size && didx != q->head)) {
+        dev_info(dev->dev, "Queue %d state lost: BASE=0x%08x CNT=%u CIDX=%u DIDX=%u\n",
+                 q->hw_idx, base, cnt, cidx, didx);
+        return false;
+    }
+
+    return true;
+}
+
+/* ============================================
+ * TX Queue Operations
+ * ============================================ */
+
+/* Free descriptors of a TX ring; called with the queue lock held */
+static int mt7927_tx_ring_avail(struct mt7927_queue *q)
+{
+    int avail = q->tail - q->head - 1;
+
+    return avail < 0 ? avail + q->ndesc : avail;
+}
+
+/**
+ * mt7927_tx_flow_queued - Account a frame put on the data ring
+ *
+ * Pauses the TXQ scheduler once the ring holds more bytes than the
+ * byte queue limit currently allows, or is close to running out of
+ * descriptors. Called with the queue lock held.
+ */
+static void mt7927_tx_flow_queued(struct mt7927_queue *q, unsigned int bytes)
+{
+    dql_queued(&q->dql, bytes);
+
+    if (!q->stopped && (dql_avail(&q->dql) < 0 ||
+                        mt7927_tx_ring_avail(q) < MT7927_TX_STOP_DESC)) {
+        WRITE_ONCE(q->stopped, true);
+        q->stops++;
+    }
+}
+
+/**
+ * mt7927_tx_flow_completed - Account frames the data ring has sent
+ *
+ * Lets the byte queue limit adapt to how much the hardware drained, and
+ * resumes the scheduler only well below both stop thresholds so it does
+ * not flap on every completion. Called with the queue lock held.
+ */
+static void mt7927_tx_flow_completed(struct mt7927_queue *q, unsigned int bytes)
+{
+    dql_completed(&q->dql, bytes);
+
+    if (q->stopped && dql_avail(&q->dql) >= 0 &&
+        mt7927_tx_ring_avail(q) >= MT7927_TX_WAKE_DESC)
+        WRITE_ONCE(q->stopped, false);
+}
+
+/* One DMA segment of a TX frame */
+struct mt7927_tx_seg {
+    dma_addr_t addr;
+    u32 len;
+    bool owned;             /* Mapped or bounced here, released on completion */
+};
+
+static int mt7927_tx_map_seg(struct mt7927_dev *dev, void *data, u32 len,
+                             struct mt7927_tx_seg *seg)
+{
+    seg->addr = dma_map_single(dev->dev, data, len, DMA_TO_DEVICE);
+    if (dma_mapping_error(dev->dev, seg->addr))
+        return -ENOMEM;
+
+    seg->len = len;
+    seg->owned = true;
+
+    return 0;
+}
+
+/*
+ * __mt7927_tx_queue_skb - Queue an SKB, with optional caller-owned segments
+ *
+ * @txwi, if set, is sent as the first segment, ahead of the skb. Frames
+ * on the skb's frag_list (software A-MSDU subframes) follow its head as
+ * segments of their own, and @frag, if set, comes last. Segments fill
+ * descriptors two at a time (buf0/buf1); the frame's last descriptor
+ * carries LAST_SEC and the skb. Caller-owned segments stay valid until
+ * the frame completes; only what is mapped here is unmapped.
+ */
+static int __mt7927_tx_queue_skb(struct mt7927_dev *dev, struct mt7927_queue *q,
+                                 struct sk_buff *skb, struct mt7927_txwi *txwi,
+                                 dma_addr_t frag, u32 frag_len)
+{
+    struct mt7927_tx_seg seg[MT7927_TX_MAX_SEGS];
+    struct mt7927_desc *desc;
+    struct sk_buff *iter;
+    dma_addr_t dma_addr;
+    unsigned long flags;
+    int i, idx, n = 0, nseg;
+
+    nseg = !!txwi + 1 + !!frag_len;
+    skb_walk_frags(skb, iter)
+        nseg++;
+    if (WARN_ON_ONCE(nseg > MT7927_TX_MAX_SEGS))
+        return -EINVAL;
+
+    spin_lock_irqsave(&q->lock, flags);
+
     /*
-     * Configure hardware ring registers
-     * Ring register layout (from mt76_queue_regs):
-     *   offset 0x00: desc_base (32-bit DMA address, low bits)
-     *   offset 0x04: ring_size (descriptor count)
-     *   offset 0x08: cpu_idx
-     *   offset 0x0c: dma_idx
-     *
-     * For 64-bit DMA, high bits are written to EXT_CTRL registers.
+     * Data frames never wake the chip inline; park them and let the
+     * wake work flush them. MCU senders hold mt7927_pm_get() instead.
      */
-    dev_info(dev->dev, "Queue %d: writing ring_base=0x%x, dma=0x%llx, ndesc=%d\n",
-             idx, ring_base, (u64)q->desc_dma, ndesc);
+    if (q == &dev->tx_q[0] && !mt7927_pm_ref(dev)) {
+        spin_unlock_irqrestore(&q->lock, flags);
+        mt7927_pm_queue_skb(dev, skb);
+        return 0;
+    }
 
-    mt7927_wr(dev, ring_base + 0x00, lower_32_bits(q->desc_dma));  /* Base (low 32 bits) */
-    mt7927_wr(dev, ring_base + 0x04, ndesc);                        /* Ring size (count) */
-    mt7927_wr(dev, ring_base + 0x08, 0);                            /* CPU index */
-    mt7927_wr(dev, ring_base + 0x0c, 0);                            /* DMA index */
-    wmb();  /* Ensure writes are visible to hardware */
+    /* Check if queue has room for every descriptor of the frame */
+    if (mt7927_tx_ring_avail(q) < DIV_ROUND_UP(nseg, 2)) {
+        spin_unlock_irqrestore(&q->lock, flags);
+        return -ENOSPC;
+    }
 
-    /* Verify the write succeeded */
-    {
-        u32 readback = mt7927_rr(dev, ring_base);
-        if (readback != lower_32_bits(q->desc_dma)) {
-            dev_warn(dev->dev, "Queue %d: ring base write failed! wrote=0x%x, read=0x%x\n",
-                     idx, lower_32_bits(q->desc_dma), readback);
+    if (txwi)
+        seg[n++] = (struct mt7927_tx_seg){ txwi->dma, MT_TXD_SIZE, false };
+
+    /* Small frames go out of the bounce pool, the rest are mapped */
+    if (mt7927_tx_bounce_get(q, skb, &dma_addr)) {
+        seg[n++] = (struct mt7927_tx_seg){ dma_addr, skb->len, true };
+    } else {
+        if (mt7927_tx_map_seg(dev, skb->data, skb_headlen(skb), &seg[n]))
+            goto err_unmap;
+        n++;
+
+        skb_walk_frags(skb, iter) {
+            if (mt7927_tx_map_seg(dev, iter->data, iter->len, &seg[n]))
+                goto err_unmap;
+            n++;
         }
     }
 
-    dev_dbg(dev->dev, "Queue %d allocated: %d descriptors at 0x%llx\n",
-            idx, ndesc, (u64)q->desc_dma);
+    if (frag_len)
+        seg[n++] = (struct mt7927_tx_seg){ frag, frag_len, false };
+
+    /* Set up descriptors */
+    for (i = 0; i < n; i += 2) {
+        struct mt7927_tx_map *map;
+        u32 ctrl;
+
+        idx = q->head;
+        desc = &q->desc[idx];
+        map = &q->map[idx];
+
+        desc->buf0 = cpu_to_le32(lower_32_bits(seg[i].addr));
+        ctrl = FIELD_PREP(MT_DMA_CTL_SD_LEN0, seg[i].len);
+        if (seg[i].owned) {
+            map->addr[0] = seg[i].addr;
+            map->len[0] = seg[i].len;
+        }
+
+        if (i + 1 < n) {
+            desc->buf1 = cpu_to_le32(lower_32_bits(seg[i + 1].addr));
+            ctrl |= FIELD_PREP(MT_DMA_CTL_SD_LEN1, seg[i + 1].len);
+            if (i + 2 >= n)
+                ctrl |= MT_DMA_CTL_LAST_SEC1;
+            if (seg[i + 1].owned) {
+                map->addr[1] = seg[i + 1].addr;
+                map->len[1] = seg[i + 1].len;
+            }
+        } else {
+            desc->buf1 = cpu_to_le32(upper_32_bits(seg[i].addr));
+            ctrl |= MT_DMA_CTL_LAST_SEC0;
+        }
+
+        desc->ctrl = cpu_to_le32(ctrl);
+        desc->info = 0;
+        q->skb[idx] = NULL;
+        q->head = (idx + 1) % q->ndesc;
+    }
+
+    /* The frame is reported when its last descriptor completes */
+    q->skb[idx] = skb;
+    wmb();  /* Ensure descriptors are written before updating index */
+
+    q->frames++;
+    if (q == &dev->tx_q[0])
+        mt7927_tx_flow_queued(q, skb->len);
+
+    /* Kick the hardware */
+    mt7927_wr(dev, MT_WFDMA0_TX_RING_CIDX(q->hw_idx), q->head);
+
+    spin_unlock_irqrestore(&q->lock, flags);
 
     return 0;
 
-err_free_buffers:
-    for (i = 0; i < ndesc; i++) {
-        if (q->skb[i]) {
-            if (q->dma_addr[i])
-                dma_unmap_single(dev->dev, q->dma_addr[i], buf_size,
-                                DMA_FROM_DEVICE);
-            dev_kfree_skb(q->skb[i]);
-        }
+err_unmap:
+    while (n--) {
+        if (seg[n].owned)
+            mt7927_tx_release(dev, q, seg[n].addr, seg[n].len);
     }
-    kfree(q->dma_addr);
-err_free_skb:
-    kfree(q->skb);
-err_free_desc:
-    dma_free_coherent(dev->dev, size, q->desc, q->desc_dma);
+    spin_unlock_irqrestore(&q->lock, flags);
     return -ENOMEM;
 }
 
 /**
- * mt7927_queue_free - Free a DMA queue
+ * mt7927_tx_queue_skb - Queue an SKB for transmission
  */
-void mt7927_queue_free(struct mt7927_dev *dev, struct mt7927_queue *q)
+int mt7927_tx_queue_skb(struct mt7927_dev *dev, struct mt7927_queue *q,
+                        struct sk_buff *skb)
 {
-    int i;
-
-    if (!q->desc)
-        return;
+    return __mt7927_tx_queue_skb(dev, q, skb, NULL, 0, 0);
+}
 
-    /* Free any remaining SKBs and DMA mappings */
-    for (i = 0; i < q->ndesc; i++) {
-        if (q->skb && q->skb[i]) {
-            if (q->dma_addr && q->dma_addr[i])
-                dma_unmap_single(dev->dev, q->dma_addr[i],
-                                MT_RX_BUF_SIZE, DMA_FROM_DEVICE);
-            dev_kfree_skb(q->skb[i]);
-        }
-    }
+/**
+ * mt7927_tx_queue_skb_frag - Queue an SKB header plus a pre-mapped payload
+ * @dev: device structure
+ * @q: TX queue
+ * @skb: header, mapped here and unmapped on completion
+ * @frag: payload DMA address, owned by the caller
+ * @frag_len: payload length (SD_LEN1, at most 16383 bytes)
+ */
+int mt7927_tx_queue_skb_frag(struct mt7927_dev *dev, struct mt7927_queue *q,
+                             struct sk_buff *skb, dma_addr_t frag, u32 frag_len)
+{
+    if (WARN_ON_ONCE(!frag_len ||
+                     frag_len > FIELD_MAX(MT_DMA_CTL_SD_LEN1)))
+        return -EINVAL;
 
-    kfree(q->dma_addr);
-    kfree(q->skb);
+    return __mt7927_tx_queue_skb(dev, q, skb, NULL, frag, frag_len);
+}
 
-    dma_free_coherent(dev->dev, q->ndesc * sizeof(struct mt7927_desc),
-                      q->desc, q->desc_dma);
+/**
+ * mt7927_tx_queue_txwi - Queue a TXD buffer followed by an untouched frame
+ * @dev: device structure
+ * @q: TX queue
+ * @txwi: TXD, from mt7927_txwi_get(); owned by the caller
+ * @skb: frame, mapped here and unmapped on completion; A-MSDU subframes
+ *       built by mac80211 hang off its frag_list
+ */
+int mt7927_tx_queue_txwi(struct mt7927_dev *dev, struct mt7927_queue *q,
+                         struct mt7927_txwi *txwi, struct sk_buff *skb)
+{
+    if (WARN_ON_ONCE(skb_headlen(skb) > FIELD_MAX(MT_DMA_CTL_SD_LEN1)))
+        return -EINVAL;
 
-    memset(q, 0, sizeof(*q));
+    return __mt7927_tx_queue_skb(dev, q, skb, txwi, 0, 0);
 }
 
-/* ============================================
- * TX Queue Operations
- * ============================================ */
-
 /**
- * mt7927_tx_queue_skb - Queue an SKB for transmission
+ * __mt7927_tx_complete - Reap the descriptors the hardware has consumed
+ * @dev: device structure
+ * @q: TX queue
+ * @budget: NAPI budget, 0 outside NAPI context
+ *
+ * The batch runs from the tail up to the ring's DMA index. Submitters
+ * never touch that range, so its streaming mappings are unmapped and its
+ * frames collected holding only cleanup_lock, which keeps reapers apart.
+ * The queue lock is then taken once for the whole batch to return bounce
+ * slots, move the tail and update flow control. Frames are reported or
+ * freed after both locks are dropped.
  */
-int mt7927_tx_queue_skb(struct mt7927_dev *dev, struct mt7927_queue *q,
-                        struct sk_buff *skb)
+static void __mt7927_tx_complete(struct mt7927_dev *dev,
+                                 struct mt7927_queue *q, int budget)
 {
-    struct mt7927_desc *desc;
-    dma_addr_t dma_addr;
+    struct sk_buff_head done;
+    struct sk_buff *skb;
+    unsigned int bytes = 0;
     unsigned long flags;
-    int idx;
+    int i, idx, end, head;
 
-    spin_lock_irqsave(&q->lock, flags);
+    if (!q->desc)
+        return;
 
-    /* Check if queue is full */
-    idx = q->head;
-    if (((idx + 1) % q->ndesc) == q->tail) {
-        spin_unlock_irqrestore(&q->lock, flags);
-        return -ENOSPC;
-    }
+    __skb_queue_head_init(&done);
 
-    /* Map the SKB data */
-    dma_addr = dma_map_single(dev->dev, skb->data, skb->len, DMA_TO_DEVICE);
-    if (dma_mapping_error(dev->dev, dma_addr)) {
-        spin_unlock_irqrestore(&q->lock, flags);
-        return -ENOMEM;
+    spin_lock_bh(&q->cleanup_lock);
+
+    /*
+     * The DMA index only trails what was queued; anything else is a chip
+     * that lost its ring state, which recovery cleans up.
+     */
+    end = mt7927_rr(dev, MT_WFDMA0_TX_RING_DIDX(q->hw_idx));
+    head = READ_ONCE(q->head);
+    if (end >= q->ndesc ||
+        (end - q->tail + q->ndesc) % q->ndesc >
+        (head - q->tail + q->ndesc) % q->ndesc) {
+        spin_unlock_bh(&q->cleanup_lock);
+        return;
     }
 
-    /* Store SKB and DMA address */
-    q->skb[idx] = skb;
-    q->dma_addr[idx] = dma_addr;
+    for (idx = q->tail; idx != end; idx = (idx + 1) % q->ndesc) {
+        struct mt7927_tx_map *map = &q->map[idx];
 
-    /* Set up descriptor */
-    desc = &q->desc[idx];
-    desc->buf0 = cpu_to_le32(lower_32_bits(dma_addr));
-    desc->buf1 = cpu_to_le32(upper_32_bits(dma_addr));
-    desc->ctrl = cpu_to_le32(skb->len | MT_DMA_CTL_LAST_SEC0);
-    desc->info = 0;
-    wmb();  /* Ensure descriptor is written before updating index */
+        /* Bounce slots go back to the pool under the queue lock below */
+        for (i = 0; i < ARRAY_SIZE(map->len); i++) {
+            if (!map->len[i] || mt7927_tx_bounced(q, map->addr[i]))
+                continue;
+
+            dma_unmap_single(dev->dev, map->addr[i], map->len[i],
+                             DMA_TO_DEVICE);
+            map->len[i] = 0;
+        }
 
-    /* Update head index */
-    q->head = (idx + 1) % q->ndesc;
+        /* The frame hangs off its last descriptor */
+        skb = q->skb[idx];
+        if (!skb)
+            continue;
 
-    /* Kick the hardware */
-    mt7927_wr(dev, MT_WFDMA0_TX_RING_CIDX(q->hw_idx), q->head);
+        q->skb[idx] = NULL;
+        if (q == &dev->tx_q[0])
+            bytes += skb->len;
+        __skb_queue_tail(&done, skb);
+    }
 
-    /* Debug: Check if DMA picks up the command */
-    {
-        u32 cidx = mt7927_rr(dev, MT_WFDMA0_TX_RING_CIDX(q->hw_idx));
-        u32 didx = mt7927_rr(dev, MT_WFDMA0_TX_RING_DIDX(q->hw_idx));
-        u32 base = mt7927_rr(dev, MT_WFDMA0_TX_RING_BASE(q->hw_idx));
-        u32 cnt = mt7927_rr(dev, MT_WFDMA0_TX_RING_CNT(q->hw_idx));
-        dev_info(dev->dev, "TX Q%d: CIDX=%d DIDX=%d BASE=0x%08x CNT=%d\n",
-                 q->hw_idx, cidx, didx, base, cnt);
+    spin_lock_irqsave(&q->lock, flags);
+
+    for (idx = q->tail; idx != end; idx = (idx + 1) % q->ndesc) {
+        mt7927_tx_unmap(dev, q, idx);
+        q->desc[idx].ctrl = 0;
     }
+    q->tail = end;
+
+    /* mt7927_mac_tx_done() kicks the scheduler if this woke the ring */
+    if (bytes)
+        mt7927_tx_flow_completed(q, bytes);
 
     spin_unlock_irqrestore(&q->lock, flags);
+    spin_unlock_bh(&q->cleanup_lock);
+
+    if (q == &dev->tx_q[0]) {
+        if (!skb_queue_empty(&done))
+            mt7927_mac_tx_done(dev, &done, budget);
+    } else {
+        while ((skb = __skb_dequeue(&done)) != NULL) {
+            if (q == dev->q_mcu[MT_MCUQ_WM] || q == dev->q_mcu[MT_MCUQ_FWDL])
+                mt7927_mcu_tx_done(dev, skb);
+            napi_consume_skb(skb, budget);
+        }
+    }
 
-    return 0;
+    if (wq_has_sleeper(&q->wait))
+        wake_up(&q->wait);
 }
 
 /**
  * mt7927_tx_complete - Process completed TX descriptors
+ *
+ * For callers outside NAPI: the IRQ tasklet (MCU rings), ring waiters
+ * and suspend.
  */
 void mt7927_tx_complete(struct mt7927_dev *dev, struct mt7927_queue *q)
 {
-    struct mt7927_desc *desc;
-    unsigned long flags;
-    int idx;
+    __mt7927_tx_complete(dev, q, 0);
+}
 
-    spin_lock_irqsave(&q->lock, flags);
+/* ============================================
+ * Completion Waiting
+ * ============================================ */
 
-    while (q->tail != q->head) {
-        idx = q->tail;
-        desc = &q->desc[idx];
+/**
+ * mt7927_compl_begin - Start a wait and size its busy-wait window
+ *
+ * Returns how long to spin, in microseconds. HYBRID spins for twice the
+ * recent latency when that fits under MT7927_COMPL_SPIN_MAX_US; a ring
+ * whose completions are slower sleeps right away, except every 16th
+ * wait, which probes with the full window in case things sped up.
+ */
+u32 mt7927_compl_begin(struct mt7927_compl *c)
+{
+    u32 lat;
 
-        /* Check if DMA has completed this descriptor */
-        if (!(le32_to_cpu(desc->ctrl) & MT_DMA_CTL_DMA_DONE))
-            break;
+    c->waits++;
 
-        /* Unmap and free the SKB */
-        if (q->skb[idx]) {
-            dma_unmap_single(dev->dev, q->dma_addr[idx],
-                            q->skb[idx]->len, DMA_TO_DEVICE);
-            dev_kfree_skb_irq(q->skb[idx]);
-            q->skb[idx] = NULL;
-            q->dma_addr[idx] = 0;
-        }
+    switch (c->mode) {
+    case MT7927_COMPL_IRQ:
+        return 0;
+    case MT7927_COMPL_POLL:
+        return U32_MAX;
+    default:
+        break;
+    }
 
-        /* Clear descriptor */
-        desc->ctrl = 0;
+    lat = ewma_compl_lat_read(&c->lat_us);
+    if (!lat)
+        return MT7927_COMPL_SPIN_MAX_US;
+    if (2 * lat <= MT7927_COMPL_SPIN_MAX_US)
+        return 2 * lat;
 
-        /* Move tail forward */
-        q->tail = (idx + 1) % q->ndesc;
+    return (c->waits % 16) ? 0 : MT7927_COMPL_SPIN_MAX_US;
+}
+
+/**
+ * mt7927_compl_end - Account how a wait finished
+ */
+void mt7927_compl_end(struct mt7927_compl *c, ktime_t start,
+                      enum mt7927_compl_by by)
+{
+    s64 us = ktime_us_delta(ktime_get(), start);
+
+    switch (by) {
+    case MT7927_COMPL_BY_POLL:
+        c->polled++;
+        break;
+    case MT7927_COMPL_BY_IRQ:
+        c->irq++;
+        break;
+    default:
+        c->timeouts++;
+        return;
+    }
+
+    /* Offset by one so a zero average still means "no history" */
+    ewma_compl_lat_add(&c->lat_us, clamp_t(s64, us, 0, USEC_PER_SEC) + 1);
+}
+
+/* Whether everything queued on @q has been reaped; has no side effects */
+static bool mt7927_tx_ring_idle(struct mt7927_queue *q)
+{
+    return READ_ONCE(q->tail) == READ_ONCE(q->head);
+}
+
+static bool mt7927_tx_reap_idle(struct mt7927_dev *dev, struct mt7927_queue *q)
+{
+    mt7927_tx_complete(dev, q);
+
+    return mt7927_tx_ring_idle(q);
+}
+
+/**
+ * mt7927_tx_wait_idle - Wait until the hardware has consumed a TX ring
+ * @dev: device structure
+ * @q: TX queue
+ * @timeout: in jiffies
+ *
+ * Within the spin window the ring is reaped here. After that the IRQ
+ * tasklet reaps it and wakes us, so the sleeping condition only looks at
+ * the ring indices; reaping from inside it would wake the waiter on every
+ * check. One last reap before giving up catches a lost interrupt.
+ */
+int mt7927_tx_wait_idle(struct mt7927_dev *dev, struct mt7927_queue *q,
+                        unsigned long timeout)
+{
+    struct mt7927_compl *c = &q->compl;
+    unsigned long deadline = jiffies + timeout;
+    ktime_t start = ktime_get();
+    u32 spin = mt7927_compl_begin(c);
+
+    do {
+        if (mt7927_tx_reap_idle(dev, q)) {
+            mt7927_compl_end(c, start, MT7927_COMPL_BY_POLL);
+            return 0;
+        }
+
+        if (c->mode == MT7927_COMPL_POLL)
+            usleep_range(20, 50);
+        else
+            cpu_relax();
+    } while (ktime_us_delta(ktime_get(), start) < spin &&
+             time_before(jiffies, deadline));
+
+    if (c->mode != MT7927_COMPL_POLL &&
+        wait_event_timeout(q->wait, mt7927_tx_ring_idle(q),
+                           max_t(long, deadline - jiffies, 1))) {
+        mt7927_compl_end(c, start, MT7927_COMPL_BY_IRQ);
+        return 0;
     }
 
-    /* Wake queue if it was stopped */
-    if (q->stopped) {
-        q->stopped = false;
-        /* TODO: Signal that queue is available */
+    if (mt7927_tx_reap_idle(dev, q)) {
+        mt7927_compl_end(c, start, MT7927_COMPL_BY_POLL);
+        return 0;
     }
 
-    spin_unlock_irqrestore(&q->lock, flags);
+    mt7927_compl_end(c, start, MT7927_COMPL_BY_TIMEOUT);
+    return -ETIMEDOUT;
 }
 
 /* ============================================
  * RX Queue Operations
  * ============================================ */
 
+/**
+ * mt7927_rx_add_frag - Attach a continuation buffer to the frame in q->rx_head
+ *
+ * The buffer becomes a page fragment of the head skb; nothing is copied.
+ * Returns: false if the frame has run out of fragment slots.
+ */
+static bool mt7927_rx_add_frag(struct mt7927_queue *q, void *buf, int len)
+{
+    struct sk_buff *skb = q->rx_head;
+    int nr_frags = skb_shinfo(skb)->nr_frags;
+    struct page *page;
+
+    if (nr_frags >= MAX_SKB_FRAGS)
+        return false;
+
+    page = virt_to_head_page(buf);
+    skb_add_rx_frag(skb, nr_frags, page, buf - page_address(page), len,
+                    mt7927_rx_frag_size(q));
+
+    return true;
+}
+
 /**
  * mt7927_rx_poll - Poll RX queue for received packets
+ *
+ * A frame larger than one buffer arrives over consecutive descriptors,
+ * with LAST_SEC0 set only on the final one. The first buffer becomes the
+ * skb head and the rest are chained as page fragments, so any MPDU size
+ * is received with fixed-size buffers and without copying.
+ *
+ * Single-buffer frames up to dev->rx_copybreak bytes (TCP ACKs, MCU
+ * events) are copied instead, and their buffer is re-armed in place.
  */
 int mt7927_rx_poll(struct mt7927_dev *dev, struct mt7927_queue *q, int budget)
 {
     struct mt7927_desc *desc;
-    struct sk_buff *skb, *new_skb;
+    struct sk_buff *skb;
+    struct sk_buff_head frames;
     dma_addr_t dma_addr;
     unsigned long flags;
     int idx, len, count = 0;
+    u32 ctrl, info;
+    void *buf, *new_buf;
+    bool more;
+
+    __skb_queue_head_init(&frames);
 
     spin_lock_irqsave(&q->lock, flags);
 
@@ -301,75 +1114,96 @@ int mt7927_rx_poll(struct mt7927_dev *dev, struct mt7927_queue *q, int budget)
         desc = &q->desc[idx];
 
         /* Check if DMA has completed this descriptor */
-        if (!(le32_to_cpu(desc->ctrl) & MT_DMA_CTL_DMA_DONE))
+        ctrl = le32_to_cpu(desc->ctrl);
+        if (!(ctrl & MT_DMA_CTL_DMA_DONE))
             break;
 
-        /* Get received length */
-        len = FIELD_GET(MT_DMA_CTL_SD_LEN0, le32_to_cpu(desc->ctrl));
+        len = FIELD_GET(MT_DMA_CTL_SD_LEN0, ctrl);
+        more = !(ctrl & MT_DMA_CTL_LAST_SEC0);
+        info = le32_to_cpu(desc->info);
+        buf = q->buf[idx];
+        count++;
 
-        /* Get the received SKB */
-        skb = q->skb[idx];
-        if (!skb)
-            goto next;
+        /* Small frame: copy it out and leave the buffer posted */
+        if (!more && !q->rx_head && !q->rx_discard &&
+            len <= READ_ONCE(dev->rx_copybreak)) {
+            skb = mt7927_rx_buf_copy(dev, q, idx, len);
+            if (!skb)
+                goto next;
 
-        /* Unmap the buffer */
-        dma_unmap_single(dev->dev, q->dma_addr[idx], MT_RX_BUF_SIZE,
-                        DMA_FROM_DEVICE);
-
-        /* Allocate new buffer */
-        new_skb = dev_alloc_skb(MT_RX_BUF_SIZE);
-        if (!new_skb) {
-            /* Reuse old buffer */
-            dma_addr = dma_map_single(dev->dev, skb->data, MT_RX_BUF_SIZE,
-                                      DMA_FROM_DEVICE);
-            if (!dma_mapping_error(dev->dev, dma_addr)) {
-                q->dma_addr[idx] = dma_addr;
-                desc->buf0 = cpu_to_le32(lower_32_bits(dma_addr));
-                desc->buf1 = cpu_to_le32(upper_32_bits(dma_addr));
-            }
+            *(u32 *)skb->cb = info;
+            goto deliver;
+        }
+
+        /* Swap in a fresh buffer; without one, re-arm this one and drop */
+        new_buf = mt7927_rx_buf_alloc(dev, q, &dma_addr);
+        if (!new_buf) {
+            dev_kfree_skb_any(q->rx_head);
+            q->rx_head = NULL;
+            q->rx_discard = more;
             goto next;
         }
 
-        /* Map new buffer */
-        dma_addr = dma_map_single(dev->dev, new_skb->data, MT_RX_BUF_SIZE,
-                                  DMA_FROM_DEVICE);
-        if (dma_mapping_error(dev->dev, dma_addr)) {
-            dev_kfree_skb(new_skb);
-            /* Reuse old buffer */
-            dma_addr = dma_map_single(dev->dev, skb->data, MT_RX_BUF_SIZE,
-                                      DMA_FROM_DEVICE);
-            if (!dma_mapping_error(dev->dev, dma_addr)) {
-                q->dma_addr[idx] = dma_addr;
-                desc->buf0 = cpu_to_le32(lower_32_bits(dma_addr));
-                desc->buf1 = cpu_to_le32(upper_32_bits(dma_addr));
-            }
+        dma_unmap_single(dev->dev, q->dma_addr[idx], q->buf_size,
+                         DMA_FROM_DEVICE);
+        mt7927_rx_buf_post(q, idx, new_buf, dma_addr);
+
+        /* Rest of a frame whose head was already dropped */
+        if (q->rx_discard) {
+            skb_free_frag(buf);
+            q->rx_discard = more;
             goto next;
         }
 
-        /* Set received data length */
-        skb_put(skb, len);
+        if (q->rx_head) {
+            if (!mt7927_rx_add_frag(q, buf, len)) {
+                skb_free_frag(buf);
+                dev_kfree_skb_any(q->rx_head);
+                q->rx_head = NULL;
+                q->rx_discard = more;
+                goto next;
+            }
+            if (more)
+                goto next;
+
+            skb = q->rx_head;
+            q->rx_head = NULL;
+        } else {
+            skb = build_skb(buf, mt7927_rx_frag_size(q));
+            if (!skb) {
+                skb_free_frag(buf);
+                q->rx_discard = more;
+                goto next;
+            }
+            __skb_put(skb, len);
+
+            /* DMA info word, read by the data path for checksum status */
+            *(u32 *)skb->cb = info;
+
+            if (more) {
+                q->rx_head = skb;
+                goto next;
+            }
+        }
 
-        /* Store new buffer in queue */
-        q->skb[idx] = new_skb;
-        q->dma_addr[idx] = dma_addr;
-        desc->buf0 = cpu_to_le32(lower_32_bits(dma_addr));
-        desc->buf1 = cpu_to_le32(upper_32_bits(dma_addr));
+deliver:
+        q->frames++;
 
         /* Process the received SKB */
         if (q->hw_idx == MT7927_RXQ_MCU_WM) {
-            /* MCU response - add to response queue */
-            skb_queue_tail(&dev->mcu.res_q, skb);
-            wake_up(&dev->mcu.wait);
+            /* MCU response or event - parsed in place, so keep it linear */
+            if (skb_linearize(skb))
+                dev_kfree_skb_any(skb);
+            else
+                mt7927_mcu_rx_event(dev, skb);
         } else {
-            /* Data packet - would go to mac80211 */
-            dev_kfree_skb(skb);  /* For now, just free */
+            /* Data ring: delivered to mac80211 outside the ring lock */
+            __skb_queue_tail(&frames, skb);
         }
 
-        count++;
-
 next:
         /* Clear DMA done flag and reset length */
-        desc->ctrl = cpu_to_le32(MT_RX_BUF_SIZE);
+        desc->ctrl = cpu_to_le32(q->buf_size);
         wmb();
 
         /* Update tail and notify hardware */
@@ -379,9 +1213,95 @@ next:
 
     spin_unlock_irqrestore(&q->lock, flags);
 
+    if (!skb_queue_empty(&frames))
+        mt7927_mac_rx_list(dev, &frames);
+
     return count;
 }
 
+/**
+ * mt7927_rx_napi_poll - NAPI poll for the band0 data RX ring
+ *
+ * The data RX interrupt stays masked from the tasklet until the ring is
+ * drained, so one interrupt yields a whole batch for mac80211.
+ */
+static int mt7927_rx_napi_poll(struct napi_struct *napi, int budget)
+{
+    struct mt7927_dev *dev = container_of(napi, struct mt7927_dev, rx_napi);
+    int done;
+
+    /* Dozing: the wake work reschedules us once the driver owns the chip */
+    if (!mt7927_pm_ref(dev)) {
+        napi_complete(napi);
+        return 0;
+    }
+
+    done = mt7927_rx_poll(dev, &dev->rx_q[MT7927_RXQ_BAND0], budget);
+
+    if (done < budget && napi_complete_done(napi, done))
+        mt7927_irq_enable(dev, dev->irq_map->rx.data_complete_mask);
+
+    return done;
+}
+
+/**
+ * mt7927_tx_napi_poll - NAPI poll for band0 data TX completions
+ *
+ * Completions only give back ring space, so the ring is always reaped in
+ * full; @budget just lets napi_consume_skb() recycle the frames into the
+ * per-CPU skb cache. The interrupt stays masked until the poll is done.
+ */
+static int mt7927_tx_napi_poll(struct napi_struct *napi, int budget)
+{
+    struct mt7927_dev *dev = container_of(napi, struct mt7927_dev, tx_napi);
+
+    /* Dozing: the wake work reschedules us once the driver owns the chip */
+    if (!mt7927_pm_ref(dev)) {
+        napi_complete(napi);
+        return 0;
+    }
+
+    __mt7927_tx_complete(dev, &dev->tx_q[0], budget);
+
+    if (napi_complete(napi))
+        mt7927_irq_enable(dev, MT_INT_TX_DONE_BAND0);
+
+    return 0;
+}
+
+/**
+ * mt7927_napi_init - Set up the data RX and TX completion NAPI contexts
+ */
+static int mt7927_napi_init(struct mt7927_dev *dev)
+{
+    dev->napi_dev = alloc_netdev_dummy(0);
+    if (!dev->napi_dev)
+        return -ENOMEM;
+
+    strscpy(dev->napi_dev->name, dev_name(dev->dev),
+            sizeof(dev->napi_dev->name));
+
+    netif_napi_add(dev->napi_dev, &dev->rx_napi, mt7927_rx_napi_poll);
+    netif_napi_add_tx(dev->napi_dev, &dev->tx_napi, mt7927_tx_napi_poll);
+    napi_enable(&dev->rx_napi);
+    napi_enable(&dev->tx_napi);
+
+    return 0;
+}
+
+static void mt7927_napi_exit(struct mt7927_dev *dev)
+{
+    if (!dev->napi_dev)
+        return;
+
+    napi_disable(&dev->tx_napi);
+    napi_disable(&dev->rx_napi);
+    netif_napi_del(&dev->tx_napi);
+    netif_napi_del(&dev->rx_napi);
+    free_netdev(dev->napi_dev);
+    dev->napi_dev = NULL;
+}
+
 /* ============================================
  * DMA Prefetch Configuration
  * ============================================ */
@@ -586,6 +1506,16 @@ int mt7927_dma_init(struct mt7927_dev *dev)
     if (ret)
         return ret;
 
+    dev->rx_copybreak = min_t(u32, rx_copybreak, MT_RX_BUF_SIZE);
+
+    ret = mt7927_napi_init(dev);
+    if (ret)
+        return ret;
+
+    ret = mt7927_txwi_init(dev);
+    if (ret)
+        goto err_cleanup;
+
     /* ---- TX Queues ---- */
 
     /* TX Queue 0: Band0 Data (not needed for firmware load, but allocate anyway) */
@@ -667,6 +1597,8 @@ void mt7927_dma_cleanup(struct mt7927_dev *dev)
     /* Disable DMA */
     mt7927_dma_disable(dev, true);
 
+    mt7927_napi_exit(dev);
+
     /* Free TX queues */
     for (i = 0; i < ARRAY_SIZE(dev->tx_q); i++)
         mt7927_queue_free(dev, &dev->tx_q[i]);
@@ -678,4 +1610,85 @@ void mt7927_dma_cleanup(struct mt7927_dev *dev)
     /* Clear MCU queue pointers */
     for (i = 0; i < __MT_MCUQ_MAX; i++)
         dev->q_mcu[i] = NULL;
+
+    mt7927_txwi_exit(dev);
+}
+
+/**
+ * mt7927_dma_suspend - Quiesce DMA while keeping every ring allocated
+ *
+ * Stops both DMA engines, waits for them to go idle and reaps whatever
+ * TX completed on the way down.
+ */
+int mt7927_dma_suspend(struct mt7927_dev *dev)
+{
+    int i, ret;
+
+    mt7927_wr(dev, dev->irq_map->host_irq_enable, 0);
+
+    ret = mt7927_dma_disable(dev, false);
+
+    for (i = 0; i < ARRAY_SIZE(dev->tx_q); i++)
+        if (dev->tx_q[i].desc)
+            mt7927_tx_complete(dev, &dev->tx_q[i]);
+
+    return ret;
+}
+
+/**
+ * mt7927_dma_resume - Restart DMA on rings that survived a power transition
+ *
+ * Returns: 0 if every ring's base and CIDX/DIDX still match and DMA was
+ * re-enabled, -ESTALE if the chip lost state and mt7927_dma_reset() is
+ * required.
+ */
+int mt7927_dma_resume(struct mt7927_dev *dev)
+{
+    bool intact = true;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(dev->tx_q); i++)
+        intact &= mt7927_queue_verify(dev, &dev->tx_q[i]);
+    for (i = 0; i < ARRAY_SIZE(dev->rx_q); i++)
+        intact &= mt7927_queue_verify(dev, &dev->rx_q[i]);
+
+    if (!intact)
+        return -ESTALE;
+
+    mt7927_set(dev, MT_WFDMA0_GLO_CFG,
+               MT_WFDMA0_GLO_CFG_TX_DMA_EN |
+               MT_WFDMA0_GLO_CFG_RX_DMA_EN |
+               MT_WFDMA0_GLO_CFG_CSR_DISP_BASE_PTR_CHAIN_EN);
+
+    mt7927_wr(dev, MT_WFDMA0_HOST_INT_ENA,
+              MT_INT_RX_DONE_ALL | MT_INT_TX_DONE_ALL | MT_INT_MCU_CMD);
+
+    return 0;
+}
+
+/**
+ * mt7927_dma_reset - Reprogram retained rings after the chip lost DMA state
+ *
+ * Same register sequence as mt7927_dma_init(), minus the allocations.
+ */
+int mt7927_dma_reset(struct mt7927_dev *dev)
+{
+    int i, ret;
+
+    dev_info(dev->dev, "Resetting DMA rings...\n");
+
+    ret = mt7927_wpdma_reset(dev, true);
+    if (ret)
+        return ret;
+
+    for (i = 0; i < ARRAY_SIZE(dev->tx_q); i++)
+        mt7927_queue_reset(dev, &dev->tx_q[i]);
+    for (i = 0; i < ARRAY_SIZE(dev->rx_q); i++)
+        mt7927_queue_reset(dev, &dev->rx_q[i]);
+
+    mt7927_wr(dev, MT_WFDMA0_TX_RING_EXT_CTRL(MT7927_TXQ_BAND0), 0x4);
+    mt7927_wr(dev, MT_WFDMA0_TX_RING_EXT_CTRL(MT7927_TXQ_MCU_WM), 0x4);
+    mt7927_wr(dev, MT_WFDMA0_TX_RING_EXT_CTRL(MT7927_TXQ_FWDL), 0x4);
+
+    return mt7927_dma_enable(dev);
 }
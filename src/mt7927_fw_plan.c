@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * MT7927 WiFi 7 Linux Driver - Firmware Transfer Planning
+ *
+ * Also built into tests/tools/mt7927_fw_plan, so only the types from
+ * mt7927_fw_plan.h are used here.
+ *
+ * Copyright (C) 2024 MT7927 Linux Driver Project
+ */
+
+#include "mt7927_fw_plan.h"
+
+/* Emit @cur as commands of at most @max_len bytes; returns the new count */
+static int mt7927_fw_plan_emit(struct mt7927_fw_cmd *cur, u32 max_len,
+                               struct mt7927_fw_cmd *cmd, int n)
+{
+    u32 take;
+
+    while (cur->len) {
+        take = cur->len < max_len ? cur->len : max_len;
+        if (cmd) {
+            cmd[n] = *cur;
+            cmd[n].len = take;
+        }
+        n++;
+        cur->addr += take;
+        cur->offset += take;
+        cur->len -= take;
+    }
+
+    return n;
+}
+
+/**
+ * mt7927_fw_plan - Turn validated regions into scatter commands
+ * @span: regions in image order
+ * @n_spans: number of regions
+ * @max_len: longest command, from the FWDL ring geometry
+ * @cmd: output array, or NULL to only count
+ *
+ * Regions that continue both the previous region's target address and
+ * its image offset are merged, so they are announced by one scatter
+ * command; a command is only split when it exceeds @max_len. Pure
+ * function of its inputs so a schedule can be checked offline.
+ *
+ * Returns the number of commands.
+ */
+int mt7927_fw_plan(const struct mt7927_fw_span *span, int n_spans,
+                   u32 max_len, struct mt7927_fw_cmd *cmd)
+{
+    struct mt7927_fw_cmd cur = {0};
+    int i, n = 0;
+
+    for (i = 0; i < n_spans; i++) {
+        if (!span[i].len)
+            continue;
+
+        if (cur.len && cur.addr + cur.len == span[i].addr &&
+            cur.offset + cur.len == span[i].offset) {
+            cur.len += span[i].len;
+            cur.n_region = i - cur.region + 1;
+            continue;
+        }
+
+        n = mt7927_fw_plan_emit(&cur, max_len, cmd, n);
+
+        cur.addr = span[i].addr;
+        cur.offset = span[i].offset;
+        cur.len = span[i].len;
+        cur.region = i;
+        cur.n_region = 1;
+    }
+
+    return mt7927_fw_plan_emit(&cur, max_len, cmd, n);
+}
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * MT7927 WiFi 7 Linux Driver - Firmware Transfer Planning
+ *
+ * Turns the validated regions of a firmware image into scatter commands.
+ * Free of kernel dependencies so tests/tools/mt7927_fw_plan can run the
+ * same code against an image offline.
+ *
+ * Copyright (C) 2024 MT7927 Linux Driver Project
+ */
+
+#ifndef __MT7927_FW_PLAN_H
+#define __MT7927_FW_PLAN_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint16_t u16;
+typedef uint32_t u32;
+#endif
+
+/* Largest firmware slice per descriptor (second segment, SD_LEN1) */
+#define MT7927_FW_SEG_MAX       8192
+
+/* One validated region: @len bytes at image @offset go to MCU @addr */
+struct mt7927_fw_span {
+    u32 addr;
+    u32 offset;
+    u32 len;
+};
+
+/*
+ * One scatter command: @len bytes at image @offset to MCU @addr, drawn
+ * from regions [@region, @region + @n_region)
+ */
+struct mt7927_fw_cmd {
+    u32 addr;
+    u32 offset;
+    u32 len;
+    u16 region;
+    u16 n_region;
+};
+
+int mt7927_fw_plan(const struct mt7927_fw_span *span, int n_spans,
+                   u32 max_len, struct mt7927_fw_cmd *cmd);
+
+#endif /* __MT7927_FW_PLAN_H */
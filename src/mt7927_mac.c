@@ -0,0 +1,650 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * MT7927 WiFi 7 Linux Driver - Data Path
+ *
+ * Builds TX descriptors for data/management frames, reports TX status to
+ * mac80211 and parses RX descriptors of received frames.
+ *
+ * Copyright (C) 2024 MT7927 Linux Driver Project
+ */
+
+#include <linux/etherdevice.h>
+#include <linux/if_vlan.h>
+#include <linux/unaligned.h>
+#include <net/mac80211.h>
+
+#include "mt7927.h"
+#include "mt7927_mcu.h"
+#include "mt7927_mac.h"
+
+/* ============================================
+ * TX Descriptor
+ * ============================================ */
+
+/* mac80211 AC (VO, VI, BE, BK) to LMAC queue */
+static const u8 mt7927_lmac_queue[IEEE80211_NUM_ACS] = {
+    [IEEE80211_AC_VO] = MT_LMAC_AC03,
+    [IEEE80211_AC_VI] = MT_LMAC_AC02,
+    [IEEE80211_AC_BE] = MT_LMAC_AC01,
+    [IEEE80211_AC_BK] = MT_LMAC_AC00,
+};
+
+/**
+ * mt7927_mac_write_txwi - Fill the TXD of an 802.11 frame
+ * @dev: device structure
+ * @txwi: TXD, sent ahead of @skb
+ * @skb: 802.11 frame
+ * @mvif: owning interface, NULL for frames without one
+ * @wcid: WTBL entry of the receiver
+ * @key: hardware key, NULL for plaintext
+ */
+static void mt7927_mac_write_txwi(struct mt7927_dev *dev, __le32 *txwi,
+                                  struct sk_buff *skb, struct mt7927_vif *mvif,
+                                  u16 wcid, struct ieee80211_key_conf *key)
+{
+    struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
+    struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+    bool multicast = is_multicast_ether_addr(hdr->addr1);
+    u8 tid = skb->priority & IEEE80211_QOS_CTL_TID_MASK;
+    __le16 fc = hdr->frame_control;
+    u8 q_idx, omac_idx = 0, band_idx = 0;
+    u32 val;
+
+    if (mvif) {
+        omac_idx = mvif->idx;
+        band_idx = mvif->band_idx;
+    }
+
+    if (ieee80211_is_data(fc)) {
+        q_idx = mt7927_lmac_queue[skb_get_queue_mapping(skb)];
+    } else {
+        struct ieee80211_mgmt *mgmt = (struct ieee80211_mgmt *)hdr;
+
+        q_idx = MT_LMAC_ALTX0;
+        if (ieee80211_is_action(fc) &&
+            mgmt->u.action.category == WLAN_CATEGORY_BACK &&
+            mgmt->u.action.u.addba_req.action_code == WLAN_ACTION_ADDBA_REQ)
+            tid = MT_TX_ADDBA;
+        else
+            tid = MT_TX_NORMAL;
+    }
+
+    val = FIELD_PREP(MT_TXD0_TX_BYTES, skb->len + MT_TXD_SIZE) |
+          FIELD_PREP(MT_TXD0_PKT_FMT, MT_TX_TYPE_SF) |
+          FIELD_PREP(MT_TXD0_Q_IDX, q_idx);
+    txwi[0] = cpu_to_le32(val);
+
+    val = FIELD_PREP(MT_TXD1_WLAN_IDX, wcid) |
+          FIELD_PREP(MT_TXD1_OWN_MAC, omac_idx) |
+          FIELD_PREP(MT_TXD1_TGID, band_idx) |
+          FIELD_PREP(MT_TXD1_HDR_FORMAT, MT_HDR_FORMAT_802_11) |
+          FIELD_PREP(MT_TXD1_HDR_INFO, ieee80211_hdrlen(fc) / 2) |
+          FIELD_PREP(MT_TXD1_TID, tid);
+    txwi[1] = cpu_to_le32(val);
+
+    val = FIELD_PREP(MT_TXD2_FRAME_TYPE,
+                     (le16_to_cpu(fc) & IEEE80211_FCTL_FTYPE) >> 2) |
+          FIELD_PREP(MT_TXD2_SUB_TYPE,
+                     (le16_to_cpu(fc) & IEEE80211_FCTL_STYPE) >> 4);
+    txwi[2] = cpu_to_le32(val);
+
+    val = FIELD_PREP(MT_TXD3_REM_TX_COUNT, 15) |
+          FIELD_PREP(MT_TXD3_BCM, multicast);
+    if (key)
+        val |= MT_TXD3_PROTECT_FRAME;
+    if (info->flags & IEEE80211_TX_CTL_NO_ACK)
+        val |= MT_TXD3_NO_ACK;
+    if (info->flags & IEEE80211_TX_CTL_INJECTED)
+        val |= MT_TXD3_SN_VALID |
+               FIELD_PREP(MT_TXD3_SEQ,
+                          IEEE80211_SEQ_TO_SN(le16_to_cpu(hdr->seq_ctrl)));
+    txwi[3] = cpu_to_le32(val);
+
+    txwi[4] = 0;
+    txwi[5] = 0;
+    txwi[6] = cpu_to_le32(MT_TXD6_DAS | MT_TXD6_DIS_MAT |
+                          FIELD_PREP(MT_TXD6_MSDU_CNT, 1));
+    txwi[7] = 0;
+}
+
+/**
+ * mt7927_mac_init_txd_8023 - Fill the per-receiver fields of an 802.3 TXD
+ * @txwi: TXD to initialize
+ * @mvif: owning interface, NULL for frames without one
+ * @wcid: WTBL entry of the receiver
+ * @wme: receiver takes QoS data frames
+ *
+ * The chip builds the 802.11 header from the WTBL entry, so everything
+ * here is fixed for the lifetime of the association.
+ */
+static void mt7927_mac_init_txd_8023(__le32 *txwi, struct mt7927_vif *mvif,
+                                     u16 wcid, bool wme)
+{
+    u8 omac_idx = 0, band_idx = 0;
+    u32 val;
+
+    if (mvif) {
+        omac_idx = mvif->idx;
+        band_idx = mvif->band_idx;
+    }
+
+    txwi[0] = cpu_to_le32(FIELD_PREP(MT_TXD0_PKT_FMT, MT_TX_TYPE_SF));
+
+    val = FIELD_PREP(MT_TXD1_WLAN_IDX, wcid) |
+          FIELD_PREP(MT_TXD1_OWN_MAC, omac_idx) |
+          FIELD_PREP(MT_TXD1_TGID, band_idx) |
+          FIELD_PREP(MT_TXD1_HDR_FORMAT, MT_HDR_FORMAT_802_3);
+    txwi[1] = cpu_to_le32(val);
+
+    val = FIELD_PREP(MT_TXD2_FRAME_TYPE, IEEE80211_FTYPE_DATA >> 2) |
+          FIELD_PREP(MT_TXD2_SUB_TYPE,
+                     wme ? IEEE80211_STYPE_QOS_DATA >> 4 : 0);
+    txwi[2] = cpu_to_le32(val);
+
+    txwi[3] = cpu_to_le32(FIELD_PREP(MT_TXD3_REM_TX_COUNT, 15));
+    txwi[4] = 0;
+    txwi[5] = 0;
+    txwi[6] = cpu_to_le32(MT_TXD6_DAS | MT_TXD6_DIS_MAT |
+                          FIELD_PREP(MT_TXD6_MSDU_CNT, 1));
+    txwi[7] = 0;
+}
+
+/**
+ * mt7927_mac_write_txwi_8023 - Complete an 802.3 TXD for one frame
+ * @txwi: TXD initialized by mt7927_mac_init_txd_8023(), sent ahead of @skb
+ * @skb: Ethernet frame
+ */
+static void mt7927_mac_write_txwi_8023(__le32 *txwi, struct sk_buff *skb)
+{
+    struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+    u8 *eth = skb->data;
+    u8 tid = skb->priority & IEEE80211_QOS_CTL_TID_MASK;
+    u32 val;
+
+    val = FIELD_PREP(MT_TXD0_TX_BYTES, skb->len + MT_TXD_SIZE) |
+          FIELD_PREP(MT_TXD0_Q_IDX,
+                     mt7927_lmac_queue[skb_get_queue_mapping(skb)]);
+    txwi[0] |= cpu_to_le32(val);
+
+    val = FIELD_PREP(MT_TXD1_TID, tid);
+    if (get_unaligned_be16(eth + 2 * ETH_ALEN) >= ETH_P_802_3_MIN)
+        val |= MT_TXD1_ETH_802_3;
+    txwi[1] |= cpu_to_le32(val);
+
+    if (info->control.hw_key)
+        txwi[3] |= cpu_to_le32(MT_TXD3_PROTECT_FRAME);
+    if (info->flags & IEEE80211_TX_CTL_NO_ACK)
+        txwi[3] |= cpu_to_le32(MT_TXD3_NO_ACK);
+}
+
+/**
+ * mt7927_mac_sta_txd_init - Cache the 802.3 TXD template of a station
+ * @dev: device structure
+ * @sta: station that just associated
+ *
+ * Called with dev->mutex held before mac80211 starts passing data frames
+ * for @sta; the TX path picks the template up once txd_valid is set.
+ */
+void mt7927_mac_sta_txd_init(struct mt7927_dev *dev, struct ieee80211_sta *sta)
+{
+    struct mt7927_sta *msta = (struct mt7927_sta *)sta->drv_priv;
+
+    WRITE_ONCE(msta->txd_valid, false);
+    mt7927_mac_init_txd_8023(msta->txd, msta->vif, msta->wcid, sta->wme);
+    smp_store_release(&msta->txd_valid, true);
+}
+
+/* ============================================
+ * TX Path
+ * ============================================ */
+
+/**
+ * mt7927_mac_tx - Put one frame from mac80211 on the data ring
+ * @dev: device structure
+ * @vif: interface the frame belongs to (may be NULL)
+ * @sta: receiving station, NULL for group-addressed or pre-association frames
+ * @skb: 802.11 frame, or Ethernet frame with encap offload; consumed in
+ *       all cases
+ *
+ * The TXD is written to a buffer from the TXWI cache and DMA'd ahead of
+ * the frame, which is left exactly as mac80211 handed it over. For
+ * Ethernet frames the chip translates the header using the station's
+ * WTBL entry.
+ */
+int mt7927_mac_tx(struct mt7927_dev *dev, struct ieee80211_vif *vif,
+                  struct ieee80211_sta *sta, struct sk_buff *skb)
+{
+    struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+    struct mt7927_vif *mvif = vif ? (struct mt7927_vif *)vif->drv_priv : NULL;
+    struct mt7927_sta *msta = sta ? (struct mt7927_sta *)sta->drv_priv : NULL;
+    u16 wcid = MT7927_WTBL_GLOBAL;
+    struct mt7927_txwi *txwi;
+    struct sk_buff *iter;
+    int ret, nsub = 1;
+
+    BUILD_BUG_ON(sizeof(struct mt7927_tx_cb) >
+                 sizeof(info->status.status_driver_data));
+
+    if (msta)
+        wcid = msta->wcid;
+    else if (mvif)
+        wcid = mvif->bc_wcid;
+
+    txwi = mt7927_txwi_get(dev);
+    if (!txwi) {
+        ieee80211_free_txskb(dev->hw, skb);
+        return -ENOMEM;
+    }
+
+    if (info->flags & IEEE80211_TX_CTL_HW_80211_ENCAP) {
+        if (msta && smp_load_acquire(&msta->txd_valid))
+            memcpy(txwi->txd, msta->txd, MT_TXD_SIZE);
+        else
+            mt7927_mac_init_txd_8023(txwi->txd, mvif, wcid,
+                                     sta && sta->wme);
+        mt7927_mac_write_txwi_8023(txwi->txd, skb);
+    } else {
+        mt7927_mac_write_txwi(dev, txwi->txd, skb, mvif, wcid,
+                              info->control.hw_key);
+    }
+
+    /* Overlays info->control, which is not needed past this point */
+    MT7927_TX_CB(skb)->txwi = txwi;
+
+    /* Software A-MSDU subframes ride on the frag_list */
+    skb_walk_frags(skb, iter)
+        nsub++;
+    dev->amsdu.hist[min(nsub, MT7927_TX_AMSDU_MAX_SUBFRAMES) - 1]++;
+
+    ret = mt7927_mac_tx_queue(dev, skb);
+    if (ret)
+        mt7927_mac_tx_drop(dev, skb);
+
+    return ret;
+}
+
+/**
+ * mt7927_mac_tx_queue - Put a data frame built by mt7927_mac_tx() on the ring
+ *
+ * Used again for frames parked while the chip was dozing.
+ */
+int mt7927_mac_tx_queue(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    return mt7927_tx_queue_txwi(dev, &dev->tx_q[0], MT7927_TX_CB(skb)->txwi,
+                                skb);
+}
+
+/**
+ * mt7927_mac_tx_drop - Release a data frame that will not be transmitted
+ * @skb: frame, its TXD buffer in MT7927_TX_CB()
+ */
+void mt7927_mac_tx_drop(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    mt7927_txwi_put(dev, MT7927_TX_CB(skb)->txwi);
+    ieee80211_free_txskb(dev->hw, skb);
+}
+
+/**
+ * mt7927_mac_tx_done - Report frames the data ring has finished with
+ * @dev: device structure
+ * @list: completed frames, TXD buffers in MT7927_TX_CB(); emptied
+ * @budget: NAPI budget, 0 outside NAPI context
+ *
+ * Releases the AQL airtime mac80211 charged at dequeue and reports the
+ * estimate as consumed airtime for airtime fairness. TX status events
+ * are not parsed yet, so a completed DMA stands in for the ACK. The
+ * whole batch is reported in one RCU section, and mac80211 hands the
+ * frames back on a free list so they are released together.
+ */
+void mt7927_mac_tx_done(struct mt7927_dev *dev, struct sk_buff_head *list,
+                        int budget)
+{
+    LIST_HEAD(free_list);
+    struct sk_buff *skb, *tmp;
+
+    local_bh_disable();
+    rcu_read_lock();
+
+    while ((skb = __skb_dequeue(list)) != NULL) {
+        struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+        struct ieee80211_tx_status status = {
+            .skb = skb,
+            .info = info,
+            .free_list = &free_list,
+        };
+        struct mt7927_txwi *txwi = MT7927_TX_CB(skb)->txwi;
+        struct mt7927_sta *msta;
+        u16 idx;
+
+        idx = FIELD_GET(MT_TXD1_WLAN_IDX, le32_to_cpu(txwi->txd[1]));
+        mt7927_txwi_put(dev, txwi);
+
+        msta = idx < MT7927_WTBL_SIZE ? rcu_dereference(dev->wcid[idx]) : NULL;
+        if (msta)
+            status.sta = container_of((void *)msta, struct ieee80211_sta,
+                                      drv_priv);
+
+        ieee80211_tx_info_clear_status(info);
+        if (!(info->flags & IEEE80211_TX_CTL_NO_ACK))
+            info->flags |= IEEE80211_TX_STAT_ACK;
+        info->status.tx_time = ieee80211_info_get_tx_time_est(info);
+
+        ieee80211_tx_status_ext(dev->hw, &status);
+    }
+
+    rcu_read_unlock();
+    local_bh_enable();
+
+    list_for_each_entry_safe(skb, tmp, &free_list, list) {
+        skb_list_del_init(skb);
+        napi_consume_skb(skb, budget);
+    }
+
+    /* Ring space and AQL budget were just returned */
+    mt7927_tx_kick(dev);
+}
+
+/* ============================================
+ * RX Path
+ * ============================================ */
+
+/* OFDM rate index by PRXV TX_RATE & 7 (hw_value 8..15 in mt7927_rates) */
+static const u8 mt7927_ofdm_rate_idx[8] = { 6, 4, 2, 0, 7, 5, 3, 1 };
+
+/**
+ * mt7927_mac_rx - Hand a frame from the data RX ring to mac80211
+ * @dev: device structure
+ * @skb: RXD followed by the frame, DMA info word in skb->cb; consumed
+ * @list: collects the frames mac80211 passes up the stack
+ *
+ * Firmware events that arrive on the data ring are passed to the MCU
+ * code. For data frames the RXD is walked once, front to back: DW0-3
+ * select the station, band and checksum state, the optional groups give
+ * the original 802.11 header fields (G4) and rate/RSSI (G3). Frames the
+ * chip already translated to 802.3 go up with RX_FLAG_8023.
+ */
+static void mt7927_mac_rx(struct mt7927_dev *dev, struct sk_buff *skb,
+                          struct list_head *list)
+{
+    struct ieee80211_rx_status *status = IEEE80211_SKB_RXCB(skb);
+    u32 csum_status = *(u32 *)skb->cb;
+    __le32 *rxd = (__le32 *)skb->data;
+    __le32 *end = (__le32 *)(skb->data + skb_headlen(skb));
+    struct ieee80211_sta *sta = NULL;
+    struct mt7927_sta *msta;
+    u32 rxd0, rxd1, rxd2, rxd3, rxd4;
+    u32 v0, v2, v3;
+    u8 chfreq, mode, idx, gi, bw, amsdu, tid = 0;
+    bool hdr_trans, unicast;
+    __le16 fc = 0;
+    u16 wlan_idx;
+    int hdr_gap;
+
+    if (skb_headlen(skb) < MT_RXD_NORMAL_SIZE)
+        goto drop;
+
+    rxd0 = le32_to_cpu(rxd[0]);
+    rxd1 = le32_to_cpu(rxd[1]);
+    rxd2 = le32_to_cpu(rxd[2]);
+    rxd3 = le32_to_cpu(rxd[3]);
+    rxd4 = le32_to_cpu(rxd[4]);
+
+    switch (FIELD_GET(MT_RXD0_PKT_TYPE, rxd0)) {
+    case MT_PKT_TYPE_NORMAL:
+        break;
+    case MT_PKT_TYPE_RX_EVENT:
+    case MT_PKT_TYPE_NORMAL_MCU:
+        if (skb_linearize(skb))
+            goto drop;
+        mt7927_mcu_rx_event(dev, skb);
+        return;
+    default:
+        goto drop;
+    }
+
+    if (!test_bit(MT7927_STATE_RUNNING, &dev->state))
+        goto drop;
+
+    if (rxd2 & (MT_RXD2_NORMAL_AMSDU_ERR | MT_RXD2_NORMAL_MAX_LEN_ERROR))
+        goto drop;
+
+    hdr_trans = rxd2 & MT_RXD2_NORMAL_HDR_TRANS;
+    if (hdr_trans && (rxd1 & MT_RXD1_NORMAL_CM))
+        goto drop;
+
+    memset(status, 0, sizeof(*status));
+
+    /* ---- DW0-DW4: station, channel, error and checksum state ---- */
+
+    unicast = FIELD_GET(MT_RXD3_NORMAL_ADDR_TYPE, rxd3) == MT_RXD3_NORMAL_U2M;
+    wlan_idx = FIELD_GET(MT_RXD1_NORMAL_WLAN_IDX, rxd1);
+    msta = wlan_idx < MT7927_WTBL_SIZE ?
+           rcu_dereference(dev->wcid[wlan_idx]) : NULL;
+    if (msta && (unicast || hdr_trans))
+        sta = container_of((void *)msta, struct ieee80211_sta, drv_priv);
+
+    /* mac80211 needs the station to route 802.3 frames */
+    if (hdr_trans && (!sta || !READ_ONCE(msta->decap)))
+        goto drop;
+
+    chfreq = FIELD_GET(MT_RXD3_NORMAL_CH_FREQ, rxd3);
+    status->band = chfreq > 14 ? NL80211_BAND_5GHZ : NL80211_BAND_2GHZ;
+    status->freq = ieee80211_channel_to_frequency(chfreq, status->band);
+
+    if ((rxd3 & (MT_RXD3_NORMAL_IP_SUM | MT_RXD3_NORMAL_UDP_TCP_SUM)) ==
+        (MT_RXD3_NORMAL_IP_SUM | MT_RXD3_NORMAL_UDP_TCP_SUM) &&
+        !(csum_status & MT_DMA_INFO_CSUM_ERR))
+        skb->ip_summed = CHECKSUM_UNNECESSARY;
+
+    if (rxd3 & MT_RXD3_NORMAL_FCS_ERR)
+        status->flag |= RX_FLAG_FAILED_FCS_CRC;
+    if (rxd1 & MT_RXD1_NORMAL_TKIP_MIC_ERR)
+        status->flag |= RX_FLAG_MMIC_ERROR;
+    if (rxd1 & MT_RXD1_NORMAL_ICV_ERR)
+        status->flag |= RX_FLAG_ONLY_MONITOR;
+
+    /* Subframes of one A-MSDU share the sequence number and PN */
+    amsdu = FIELD_GET(MT_RXD4_NORMAL_PAYLOAD_FORMAT, rxd4);
+    if (amsdu && amsdu != MT_RXD4_LAST_AMSDU_FRAME)
+        status->flag |= RX_FLAG_AMSDU_MORE;
+    if (amsdu && amsdu != MT_RXD4_FIRST_AMSDU_FRAME)
+        status->flag |= RX_FLAG_ALLOW_SAME_PN;
+
+    rxd += MT_RXD_NORMAL_SIZE / 4;
+
+    /* ---- Group 4: original frame control, sequence and QoS ---- */
+
+    if (rxd1 & MT_RXD1_NORMAL_GROUP_4) {
+        if (rxd + MT_RXD_GROUP_4_WORDS >= end)
+            goto drop;
+
+        fc = cpu_to_le16(FIELD_GET(MT_RXD8_FRAME_CONTROL,
+                                   le32_to_cpu(rxd[0])));
+        tid = FIELD_GET(MT_RXD10_QOS_CTL, le32_to_cpu(rxd[2])) &
+              IEEE80211_QOS_CTL_TID_MASK;
+        rxd += MT_RXD_GROUP_4_WORDS;
+    }
+
+    /* ---- Group 1 (IV) and group 2 (timestamp): not used ---- */
+
+    if (rxd1 & MT_RXD1_NORMAL_GROUP_1)
+        rxd += MT_RXD_GROUP_1_WORDS;
+    if (rxd1 & MT_RXD1_NORMAL_GROUP_2)
+        rxd += MT_RXD_GROUP_2_WORDS;
+
+    /* ---- Group 3: P-RXV rate and per-chain RCPI ---- */
+
+    status->flag |= RX_FLAG_NO_SIGNAL_VAL;
+
+    if (rxd1 & MT_RXD1_NORMAL_GROUP_3) {
+        if (rxd + MT_RXD_GROUP_3_WORDS >= end)
+            goto drop;
+
+        v0 = le32_to_cpu(rxd[0]);
+        v2 = le32_to_cpu(rxd[2]);
+        v3 = le32_to_cpu(rxd[3]);
+        rxd += MT_RXD_GROUP_3_WORDS;
+
+        /* Group 5 (C-RXV) only follows a P-RXV */
+        if (rxd1 & MT_RXD1_NORMAL_GROUP_5)
+            rxd += MT_RXD_GROUP_5_WORDS;
+
+        status->chains = dev->hw->wiphy->available_antennas_rx;
+        status->chain_signal[0] = MT_RCPI_TO_RSSI(MT_PRXV_RCPI0, v3);
+        status->chain_signal[1] = MT_RCPI_TO_RSSI(MT_PRXV_RCPI1, v3);
+        status->signal = max(status->chain_signal[0],
+                             status->chain_signal[1]);
+        status->flag &= ~RX_FLAG_NO_SIGNAL_VAL;
+
+        idx = FIELD_GET(MT_PRXV_TX_RATE, v0);
+        mode = FIELD_GET(MT_PRXV_TX_MODE, v2);
+        gi = FIELD_GET(MT_PRXV_HT_SHORT_GI, v2);
+        bw = FIELD_GET(MT_PRXV_FRAME_MODE, v2);
+
+        switch (mode) {
+        case MT_PHY_TYPE_CCK:
+            /* Bit 2 marks short preamble; CCK exists only on 2.4 GHz */
+            status->rate_idx = idx & 0x3;
+            if (idx & BIT(2))
+                status->enc_flags |= RX_ENC_FLAG_SHORTPRE;
+            break;
+        case MT_PHY_TYPE_OFDM:
+            status->rate_idx = mt7927_ofdm_rate_idx[idx & 0x7];
+            if (status->band == NL80211_BAND_2GHZ)
+                status->rate_idx += MT7927_CCK_RATES;
+            break;
+        case MT_PHY_TYPE_HT:
+        case MT_PHY_TYPE_HT_GF:
+            if (idx > 31)
+                goto drop;
+            status->encoding = RX_ENC_HT;
+            status->rate_idx = idx;
+            break;
+        case MT_PHY_TYPE_VHT:
+            if ((idx & 0xf) > 11)
+                goto drop;
+            status->encoding = RX_ENC_VHT;
+            status->rate_idx = idx & 0xf;
+            status->nss = FIELD_GET(MT_PRXV_NSTS, v0) + 1;
+            break;
+        case MT_PHY_TYPE_HE_SU:
+        case MT_PHY_TYPE_HE_EXT_SU:
+        case MT_PHY_TYPE_HE_TB:
+        case MT_PHY_TYPE_HE_MU:
+            status->encoding = RX_ENC_HE;
+            status->rate_idx = idx & 0xf;
+            status->nss = FIELD_GET(MT_PRXV_NSTS, v0) + 1;
+            if (gi <= NL80211_RATE_INFO_HE_GI_3_2)
+                status->he_gi = gi;
+            status->he_dcm = FIELD_GET(MT_PRXV_DCM, v2);
+            break;
+        case MT_PHY_TYPE_EHT_SU:
+        case MT_PHY_TYPE_EHT_TRIG:
+        case MT_PHY_TYPE_EHT_MU:
+            status->encoding = RX_ENC_EHT;
+            status->rate_idx = idx & 0xf;
+            status->nss = FIELD_GET(MT_PRXV_NSTS, v0) + 1;
+            if (gi <= NL80211_RATE_INFO_EHT_GI_3_2)
+                status->eht.gi = gi;
+            break;
+        default:
+            goto drop;
+        }
+
+        if (mode < MT_PHY_TYPE_HE_SU && gi)
+            status->enc_flags |= RX_ENC_FLAG_SHORT_GI;
+        status->enc_flags |= RX_ENC_FLAG_STBC_MASK *
+                             FIELD_GET(MT_PRXV_HT_STBC, v2);
+
+        switch (bw) {
+        case IEEE80211_STA_RX_BW_20:
+            break;
+        case IEEE80211_STA_RX_BW_40:
+            if (mode == MT_PHY_TYPE_HE_EXT_SU &&
+                (idx & MT_PRXV_TX_ER_SU_106T)) {
+                status->bw = RATE_INFO_BW_HE_RU;
+                status->he_ru = NL80211_RATE_INFO_HE_RU_ALLOC_106;
+            } else {
+                status->bw = RATE_INFO_BW_40;
+            }
+            break;
+        case IEEE80211_STA_RX_BW_80:
+            status->bw = RATE_INFO_BW_80;
+            break;
+        case IEEE80211_STA_RX_BW_160:
+            status->bw = RATE_INFO_BW_160;
+            break;
+        case IEEE80211_STA_RX_BW_320:
+            status->bw = RATE_INFO_BW_320;
+            break;
+        default:
+            goto drop;
+        }
+    }
+
+    /* ---- Payload ---- */
+
+    hdr_gap = (u8 *)rxd - skb->data +
+              2 * FIELD_GET(MT_RXD2_NORMAL_HDR_OFFSET, rxd2);
+    if (hdr_gap >= skb_headlen(skb))
+        goto drop;
+
+    /* Only the first fragment would be translated; leave those to the host */
+    if (hdr_trans && ieee80211_has_morefrags(fc))
+        goto drop;
+
+    skb_pull(skb, hdr_gap);
+
+    if (hdr_trans) {
+        /*
+         * On a translation error the chip inserts a 2-byte length after
+         * the VLAN tag of an 802.1Q frame; drop it.
+         */
+        if ((rxd2 & MT_RXD2_NORMAL_HDR_TRANS_ERROR) &&
+            get_unaligned_be16(skb->data + 2 * ETH_ALEN) == ETH_P_8021Q) {
+            memmove(skb->data + 2, skb->data, 2 * ETH_ALEN + VLAN_HLEN);
+            skb_pull(skb, 2);
+        }
+
+        /* mac80211 skips QoS parsing for 802.3 frames */
+        skb->priority = tid;
+        status->flag |= RX_FLAG_8023;
+    } else if (amsdu) {
+        /* De-aggregated subframes keep 2 bytes of padding after the header */
+        int pad_start = ieee80211_get_hdrlen_from_skb(skb);
+
+        memmove(skb->data + 2, skb->data, pad_start);
+        skb_pull(skb, 2);
+    }
+
+    ieee80211_rx_list(dev->hw, sta, skb, list);
+    return;
+
+drop:
+    dev_kfree_skb_any(skb);
+}
+
+/**
+ * mt7927_mac_rx_list - Deliver one NAPI poll's worth of data frames
+ * @dev: device structure
+ * @frames: RXD-prefixed frames in ring order; emptied
+ *
+ * mac80211 runs its RX handlers over the whole batch and returns the
+ * resulting 802.3 frames on one list, which is then fed through GRO so
+ * TCP segments of the same flow are merged before the stack sees them.
+ */
+void mt7927_mac_rx_list(struct mt7927_dev *dev, struct sk_buff_head *frames)
+{
+    struct sk_buff *skb, *tmp;
+    LIST_HEAD(list);
+
+    rcu_read_lock();
+    while ((skb = __skb_dequeue(frames)) != NULL)
+        mt7927_mac_rx(dev, skb, &list);
+    rcu_read_unlock();
+
+    list_for_each_entry_safe(skb, tmp, &list, list) {
+        skb_list_del_init(skb);
+        napi_gro_receive(&dev->rx_napi, skb);
+    }
+}
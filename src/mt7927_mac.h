@@ -0,0 +1,176 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * MT7927 WiFi 7 Linux Driver - Data Path Descriptor Definitions
+ *
+ * CONNAC3 TX descriptor (TXD) and RX descriptor (RXD) layouts for data
+ * frames. Word 0 of the TXD is shared with MCU messages (mt7927_mcu.h).
+ *
+ * Copyright (C) 2024 MT7927 Linux Driver Project
+ */
+
+#ifndef __MT7927_MAC_H
+#define __MT7927_MAC_H
+
+#include <linux/bitfield.h>
+
+/* ============================================
+ * TX Descriptor
+ * ============================================ */
+
+enum mt7927_tx_hdr_format {
+    MT_HDR_FORMAT_802_3,
+    MT_HDR_FORMAT_CMD,
+    MT_HDR_FORMAT_802_11,
+    MT_HDR_FORMAT_802_11_EXT,
+};
+
+/* TXD0 packet format: frame follows the TXD in the same buffer (SF) */
+enum mt7927_tx_pkt_fmt {
+    MT_TX_TYPE_CT,
+    MT_TX_TYPE_SF,
+    MT_TX_TYPE_CMD,
+    MT_TX_TYPE_FW,
+};
+
+/* LMAC queue selected by TXD0 Q_IDX */
+enum {
+    MT_LMAC_AC00,
+    MT_LMAC_AC01,
+    MT_LMAC_AC02,
+    MT_LMAC_AC03,
+    MT_LMAC_ALTX0 = 0x10,
+    MT_LMAC_BMC0,
+    MT_LMAC_BCN0,
+};
+
+/* TXD1 TID for management frames */
+enum {
+    MT_TX_NORMAL,
+    MT_TX_TIMING,
+    MT_TX_ADDBA,
+};
+
+#define MT_TXD1_FIXED_RATE      BIT(31)
+#define MT_TXD1_OWN_MAC         GENMASK(30, 25)
+#define MT_TXD1_TID             GENMASK(24, 21)
+#define MT_TXD1_ETH_802_3       BIT(20)
+#define MT_TXD1_HDR_INFO        GENMASK(20, 16)
+#define MT_TXD1_HDR_FORMAT      GENMASK(15, 14)
+#define MT_TXD1_TGID            GENMASK(13, 12)
+#define MT_TXD1_WLAN_IDX        GENMASK(11, 0)
+
+#define MT_TXD2_FRAG            GENMASK(15, 14)
+#define MT_TXD2_HTC_VLD         BIT(13)
+#define MT_TXD2_FRAME_TYPE      GENMASK(5, 4)
+#define MT_TXD2_SUB_TYPE        GENMASK(3, 0)
+
+#define MT_TXD3_SN_VALID        BIT(31)
+#define MT_TXD3_BA_DISABLE      BIT(28)
+#define MT_TXD3_SEQ             GENMASK(27, 16)
+#define MT_TXD3_REM_TX_COUNT    GENMASK(15, 11)
+#define MT_TXD3_HW_AMSDU        BIT(5)
+#define MT_TXD3_BCM             BIT(4)
+#define MT_TXD3_PROTECT_FRAME   BIT(1)
+#define MT_TXD3_NO_ACK          BIT(0)
+
+#define MT_TXD5_PID             GENMASK(7, 0)
+
+#define MT_TXD6_MSDU_CNT        GENMASK(9, 4)
+#define MT_TXD6_DIS_MAT         BIT(3)
+#define MT_TXD6_DAS             BIT(2)
+
+/* ============================================
+ * RX Descriptor
+ * ============================================ */
+
+#define MT_RXD_NORMAL_SIZE      (8 * 4)         /* DW0-DW7, before groups */
+
+enum mt7927_rx_pkt_type {
+    MT_PKT_TYPE_TXS,
+    MT_PKT_TYPE_TXRXV,
+    MT_PKT_TYPE_NORMAL,
+    MT_PKT_TYPE_RX_DUP_RFB,
+    MT_PKT_TYPE_RX_TMR,
+    MT_PKT_TYPE_RETRIEVE,
+    MT_PKT_TYPE_TXRX_NOTIFY,
+    MT_PKT_TYPE_RX_EVENT,
+    MT_PKT_TYPE_NORMAL_MCU,
+};
+
+#define MT_RXD0_LENGTH          GENMASK(15, 0)
+#define MT_RXD0_PKT_TYPE        GENMASK(31, 27)
+
+#define MT_RXD1_NORMAL_WLAN_IDX GENMASK(11, 0)
+#define MT_RXD1_NORMAL_GROUP_1  BIT(16)
+#define MT_RXD1_NORMAL_GROUP_2  BIT(17)
+#define MT_RXD1_NORMAL_GROUP_3  BIT(18)
+#define MT_RXD1_NORMAL_GROUP_4  BIT(19)
+#define MT_RXD1_NORMAL_GROUP_5  BIT(20)
+#define MT_RXD1_NORMAL_CM       BIT(23)         /* Cipher mismatch */
+#define MT_RXD1_NORMAL_CLM      BIT(24)         /* Cipher length mismatch */
+#define MT_RXD1_NORMAL_ICV_ERR  BIT(25)
+#define MT_RXD1_NORMAL_TKIP_MIC_ERR     BIT(26)
+
+#define MT_RXD2_NORMAL_HDR_TRANS        BIT(7)  /* Frame is 802.3 */
+#define MT_RXD2_NORMAL_HDR_OFFSET       GENMASK(15, 13)
+#define MT_RXD2_NORMAL_AMSDU_ERR        BIT(23)
+#define MT_RXD2_NORMAL_MAX_LEN_ERROR    BIT(24)
+#define MT_RXD2_NORMAL_HDR_TRANS_ERROR  BIT(25)
+
+#define MT_RXD3_NORMAL_CH_FREQ  GENMASK(15, 8)
+#define MT_RXD3_NORMAL_ADDR_TYPE        GENMASK(17, 16)
+#define MT_RXD3_NORMAL_U2M      BIT(0)          /* ADDR_TYPE: unicast to us */
+#define MT_RXD3_NORMAL_FCS_ERR  BIT(24)
+#define MT_RXD3_NORMAL_IP_SUM   BIT(26)         /* IP checksum checked */
+#define MT_RXD3_NORMAL_UDP_TCP_SUM      BIT(27) /* L4 checksum checked */
+
+#define MT_RXD4_NORMAL_PAYLOAD_FORMAT   GENMASK(1, 0)
+#define MT_RXD4_FIRST_AMSDU_FRAME       GENMASK(1, 0)
+#define MT_RXD4_MID_AMSDU_FRAME         BIT(1)
+#define MT_RXD4_LAST_AMSDU_FRAME        BIT(0)
+
+/* Group 4: copy of the original 802.11 header fields */
+#define MT_RXD8_FRAME_CONTROL   GENMASK(15, 0)
+#define MT_RXD10_SEQ_CTRL       GENMASK(15, 0)
+#define MT_RXD10_QOS_CTL        GENMASK(31, 16)
+
+/* Group 3: P-RXV */
+#define MT_PRXV_TX_RATE         GENMASK(6, 0)
+#define MT_PRXV_TX_ER_SU_106T   BIT(5)
+#define MT_PRXV_NSTS            GENMASK(10, 7)
+#define MT_PRXV_RCPI3           GENMASK(31, 24)
+#define MT_PRXV_RCPI2           GENMASK(23, 16)
+#define MT_PRXV_RCPI1           GENMASK(15, 8)
+#define MT_PRXV_RCPI0           GENMASK(7, 0)
+#define MT_PRXV_HT_SHORT_GI     GENMASK(4, 3)
+#define MT_PRXV_HT_STBC         GENMASK(10, 9)
+#define MT_PRXV_TX_MODE         GENMASK(14, 11)
+#define MT_PRXV_FRAME_MODE      GENMASK(2, 0)
+#define MT_PRXV_DCM             BIT(5)
+
+/* RCPI is 2 * (RSSI + 110) */
+#define MT_RCPI_TO_RSSI(_field, _v)     ((FIELD_GET(_field, _v) - 220) / 2)
+
+enum mt7927_phy_type {
+    MT_PHY_TYPE_CCK,
+    MT_PHY_TYPE_OFDM,
+    MT_PHY_TYPE_HT,
+    MT_PHY_TYPE_HT_GF,
+    MT_PHY_TYPE_VHT,
+    MT_PHY_TYPE_HE_SU = 8,
+    MT_PHY_TYPE_HE_EXT_SU,
+    MT_PHY_TYPE_HE_TB,
+    MT_PHY_TYPE_HE_MU,
+    MT_PHY_TYPE_EHT_SU = 13,
+    MT_PHY_TYPE_EHT_TRIG,
+    MT_PHY_TYPE_EHT_MU,
+};
+
+/* Group sizes in 32-bit words */
+#define MT_RXD_GROUP_1_WORDS    4
+#define MT_RXD_GROUP_2_WORDS    4
+#define MT_RXD_GROUP_3_WORDS    4
+#define MT_RXD_GROUP_4_WORDS    4
+#define MT_RXD_GROUP_5_WORDS    24
+
+#endif /* __MT7927_MAC_H */
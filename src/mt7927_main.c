@@ -0,0 +1,639 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * MT7927 WiFi 7 Linux Driver - mac80211 Interface
+ *
+ * ieee80211_hw registration, interface/station bookkeeping and TX
+ * scheduling from the mac80211 TXQs onto the data ring
+ *
+ * Copyright (C) 2024 MT7927 Linux Driver Project
+ */
+
+#include <linux/module.h>
+#include <linux/etherdevice.h>
+#include <net/mac80211.h>
+
+#include "mt7927.h"
+
+static bool tx_amsdu;
+module_param(tx_amsdu, bool, 0444);
+MODULE_PARM_DESC(tx_amsdu, "Build A-MSDUs in software instead of offloading 802.3 encapsulation (default: false)");
+
+/* ============================================
+ * Bands
+ * ============================================ */
+
+#define CHAN2G(_idx, _freq) {                   \
+    .band = NL80211_BAND_2GHZ,                  \
+    .center_freq = (_freq),                     \
+    .hw_value = (_idx),                         \
+    .max_power = 30,                            \
+}
+
+#define CHAN5G(_idx, _freq) {                   \
+    .band = NL80211_BAND_5GHZ,                  \
+    .center_freq = (_freq),                     \
+    .hw_value = (_idx),                         \
+    .max_power = 30,                            \
+}
+
+static const struct ieee80211_channel mt7927_channels_2ghz[] = {
+    CHAN2G(1, 2412), CHAN2G(2, 2417), CHAN2G(3, 2422), CHAN2G(4, 2427),
+    CHAN2G(5, 2432), CHAN2G(6, 2437), CHAN2G(7, 2442), CHAN2G(8, 2447),
+    CHAN2G(9, 2452), CHAN2G(10, 2457), CHAN2G(11, 2462), CHAN2G(12, 2467),
+    CHAN2G(13, 2472), CHAN2G(14, 2484),
+};
+
+static const struct ieee80211_channel mt7927_channels_5ghz[] = {
+    CHAN5G(36, 5180), CHAN5G(40, 5200), CHAN5G(44, 5220), CHAN5G(48, 5240),
+    CHAN5G(52, 5260), CHAN5G(56, 5280), CHAN5G(60, 5300), CHAN5G(64, 5320),
+    CHAN5G(100, 5500), CHAN5G(104, 5520), CHAN5G(108, 5540),
+    CHAN5G(112, 5560), CHAN5G(116, 5580), CHAN5G(120, 5600),
+    CHAN5G(124, 5620), CHAN5G(128, 5640), CHAN5G(132, 5660),
+    CHAN5G(136, 5680), CHAN5G(140, 5700), CHAN5G(144, 5720),
+    CHAN5G(149, 5745), CHAN5G(153, 5765), CHAN5G(157, 5785),
+    CHAN5G(161, 5805), CHAN5G(165, 5825), CHAN5G(169, 5845),
+    CHAN5G(173, 5865), CHAN5G(177, 5885),
+};
+
+/* CCK rates are only valid on 2.4 GHz; 5 GHz uses the table from index 4 */
+static struct ieee80211_rate mt7927_rates[] = {
+    { .bitrate = 10, .hw_value = 0 },
+    { .bitrate = 20, .hw_value = 1, .flags = IEEE80211_RATE_SHORT_PREAMBLE },
+    { .bitrate = 55, .hw_value = 2, .flags = IEEE80211_RATE_SHORT_PREAMBLE },
+    { .bitrate = 110, .hw_value = 3, .flags = IEEE80211_RATE_SHORT_PREAMBLE },
+    { .bitrate = 60, .hw_value = 11 },
+    { .bitrate = 90, .hw_value = 15 },
+    { .bitrate = 120, .hw_value = 10 },
+    { .bitrate = 180, .hw_value = 14 },
+    { .bitrate = 240, .hw_value = 9 },
+    { .bitrate = 360, .hw_value = 13 },
+    { .bitrate = 480, .hw_value = 8 },
+    { .bitrate = 540, .hw_value = 12 },
+};
+
+static void mt7927_init_ht_cap(struct ieee80211_sta_ht_cap *ht)
+{
+    ht->ht_supported = true;
+    ht->cap = IEEE80211_HT_CAP_SUP_WIDTH_20_40 |
+              IEEE80211_HT_CAP_SGI_20 |
+              IEEE80211_HT_CAP_SGI_40 |
+              IEEE80211_HT_CAP_LDPC_CODING |
+              IEEE80211_HT_CAP_MAX_AMSDU;
+    ht->ampdu_factor = IEEE80211_HT_MAX_AMPDU_64K;
+    ht->ampdu_density = IEEE80211_HT_MPDU_DENSITY_NONE;
+    ht->mcs.rx_mask[0] = 0xff;
+    ht->mcs.rx_mask[1] = 0xff;
+    ht->mcs.tx_params = IEEE80211_HT_MCS_TX_DEFINED;
+}
+
+static void mt7927_init_vht_cap(struct ieee80211_sta_vht_cap *vht)
+{
+    u16 mcs_map = 0;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        mcs_map |= (i < 2 ? IEEE80211_VHT_MCS_SUPPORT_0_9 :
+                    IEEE80211_VHT_MCS_NOT_SUPPORTED) << (i * 2);
+
+    vht->vht_supported = true;
+    vht->cap = IEEE80211_VHT_CAP_MAX_MPDU_LENGTH_11454 |
+               IEEE80211_VHT_CAP_RXLDPC |
+               IEEE80211_VHT_CAP_SHORT_GI_80 |
+               IEEE80211_VHT_CAP_MAX_A_MPDU_LENGTH_EXPONENT_MASK;
+    vht->vht_mcs.rx_mcs_map = cpu_to_le16(mcs_map);
+    vht->vht_mcs.tx_mcs_map = cpu_to_le16(mcs_map);
+}
+
+/**
+ * mt7927_init_bands - Set up per-device copies of the band tables
+ *
+ * mac80211 and the regulatory code write channel flags, so each device
+ * gets its own channel arrays.
+ */
+static int mt7927_init_bands(struct mt7927_dev *dev)
+{
+    struct ieee80211_supported_band *sband;
+    struct wiphy *wiphy = dev->hw->wiphy;
+
+    sband = &dev->sband_2g;
+    sband->band = NL80211_BAND_2GHZ;
+    sband->channels = devm_kmemdup(dev->dev, mt7927_channels_2ghz,
+                                   sizeof(mt7927_channels_2ghz), GFP_KERNEL);
+    if (!sband->channels)
+        return -ENOMEM;
+    sband->n_channels = ARRAY_SIZE(mt7927_channels_2ghz);
+    sband->bitrates = mt7927_rates;
+    sband->n_bitrates = ARRAY_SIZE(mt7927_rates);
+    mt7927_init_ht_cap(&sband->ht_cap);
+    if (!dev->nic_cap.valid || dev->nic_cap.has_2ghz)
+        wiphy->bands[NL80211_BAND_2GHZ] = sband;
+
+    sband = &dev->sband_5g;
+    sband->band = NL80211_BAND_5GHZ;
+    sband->channels = devm_kmemdup(dev->dev, mt7927_channels_5ghz,
+                                   sizeof(mt7927_channels_5ghz), GFP_KERNEL);
+    if (!sband->channels)
+        return -ENOMEM;
+    sband->n_channels = ARRAY_SIZE(mt7927_channels_5ghz);
+    sband->bitrates = mt7927_rates + MT7927_CCK_RATES;
+    sband->n_bitrates = ARRAY_SIZE(mt7927_rates) - MT7927_CCK_RATES;
+    mt7927_init_ht_cap(&sband->ht_cap);
+    mt7927_init_vht_cap(&sband->vht_cap);
+    if (!dev->nic_cap.valid || dev->nic_cap.has_5ghz)
+        wiphy->bands[NL80211_BAND_5GHZ] = sband;
+
+    return 0;
+}
+
+/* ============================================
+ * TX Scheduling
+ * ============================================ */
+
+/**
+ * mt7927_tx_schedule_ac - Move frames of one AC from mac80211 to the ring
+ *
+ * ieee80211_next_txq() hands out stations in airtime-fairness order and
+ * skips those over their AQL limit, so the ring only ever holds what
+ * mac80211 has decided should go next. The ring's byte queue limit
+ * (q->stopped) keeps that to what the hardware needs to stay busy; the
+ * rest waits in mac80211's fq_codel queues.
+ */
+static void mt7927_tx_schedule_ac(struct mt7927_dev *dev, u8 ac)
+{
+    struct ieee80211_hw *hw = dev->hw;
+    struct mt7927_queue *q = &dev->tx_q[0];
+    struct ieee80211_txq *txq;
+    struct sk_buff *skb;
+
+    ieee80211_txq_schedule_start(hw, ac);
+
+    while ((txq = ieee80211_next_txq(hw, ac)) != NULL) {
+        while (!READ_ONCE(q->stopped)) {
+            skb = ieee80211_tx_dequeue(hw, txq);
+            if (!skb)
+                break;
+
+            mt7927_mac_tx(dev, txq->vif, txq->sta, skb);
+        }
+
+        ieee80211_return_txq(hw, txq, false);
+
+        if (READ_ONCE(q->stopped))
+            break;
+    }
+
+    ieee80211_txq_schedule_end(hw, ac);
+}
+
+static void mt7927_tx_work(struct work_struct *work)
+{
+    struct mt7927_dev *dev = container_of(work, struct mt7927_dev, tx_work);
+    int ac;
+
+    if (!test_bit(MT7927_STATE_RUNNING, &dev->state) ||
+        test_bit(MT7927_STATE_RESET, &dev->state))
+        return;
+
+    /* Dozing: frames stay in mac80211's queues, the wake work kicks us */
+    if (!mt7927_pm_ref(dev))
+        return;
+
+    local_bh_disable();
+    rcu_read_lock();
+
+    for (ac = IEEE80211_AC_VO; ac < IEEE80211_NUM_ACS; ac++)
+        mt7927_tx_schedule_ac(dev, ac);
+
+    rcu_read_unlock();
+    local_bh_enable();
+}
+
+/**
+ * mt7927_tx_kick - Schedule a pass over the mac80211 TXQs
+ *
+ * Called when mac80211 has new frames and whenever ring space or AQL
+ * budget is returned. Safe from any context.
+ */
+void mt7927_tx_kick(struct mt7927_dev *dev)
+{
+    if (test_bit(MT7927_STATE_RUNNING, &dev->state))
+        queue_work(system_highpri_wq, &dev->tx_work);
+}
+
+/* ============================================
+ * mac80211 Operations
+ * ============================================ */
+
+static inline struct mt7927_dev *mt7927_hw_dev(struct ieee80211_hw *hw)
+{
+    return hw->priv;
+}
+
+static void mt7927_ops_tx(struct ieee80211_hw *hw,
+                          struct ieee80211_tx_control *control,
+                          struct sk_buff *skb)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+    struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+
+    mt7927_mac_tx(dev, info->control.vif, control->sta, skb);
+}
+
+static void mt7927_wake_tx_queue(struct ieee80211_hw *hw,
+                                 struct ieee80211_txq *txq)
+{
+    mt7927_tx_kick(mt7927_hw_dev(hw));
+}
+
+static int mt7927_start(struct ieee80211_hw *hw)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+    int i;
+
+    mutex_lock(&dev->mutex);
+
+    /*
+     * After ieee80211_restart_hw() mac80211 re-adds every interface and
+     * station, so the tables start from scratch here as on first start.
+     */
+    dev->vif_mask = 0;
+    bitmap_zero(dev->wcid_mask, MT7927_WTBL_SIZE);
+    __set_bit(MT7927_WTBL_GLOBAL, dev->wcid_mask);
+    for (i = 0; i < MT7927_WTBL_SIZE; i++)
+        RCU_INIT_POINTER(dev->wcid[i], NULL);
+
+    set_bit(MT7927_STATE_RUNNING, &dev->state);
+
+    mutex_unlock(&dev->mutex);
+
+    return 0;
+}
+
+static void mt7927_stop(struct ieee80211_hw *hw, bool suspend)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+
+    clear_bit(MT7927_STATE_RUNNING, &dev->state);
+    cancel_work_sync(&dev->tx_work);
+}
+
+static int mt7927_wcid_alloc(struct mt7927_dev *dev)
+{
+    int idx = find_first_zero_bit(dev->wcid_mask, MT7927_WTBL_SIZE);
+
+    if (idx >= MT7927_WTBL_SIZE)
+        return -ENOSPC;
+
+    __set_bit(idx, dev->wcid_mask);
+
+    return idx;
+}
+
+static int mt7927_add_interface(struct ieee80211_hw *hw,
+                                struct ieee80211_vif *vif)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+    struct mt7927_vif *mvif = (struct mt7927_vif *)vif->drv_priv;
+    int idx, ret = 0;
+
+    mutex_lock(&dev->mutex);
+
+    idx = ffs(~dev->vif_mask) - 1;
+    if (idx < 0 || idx >= MT7927_MAX_INTERFACES) {
+        ret = -ENOSPC;
+        goto out;
+    }
+
+    ret = mt7927_wcid_alloc(dev);
+    if (ret < 0)
+        goto out;
+
+    mvif->bc_wcid = ret;
+    mvif->idx = idx;
+    mvif->band_idx = 0;
+
+    ret = mt7927_mcu_add_dev(dev, vif, true);
+    if (ret) {
+        __clear_bit(mvif->bc_wcid, dev->wcid_mask);
+        goto out;
+    }
+
+    dev->vif_mask |= BIT(idx);
+
+out:
+    mutex_unlock(&dev->mutex);
+
+    return ret;
+}
+
+static void mt7927_remove_interface(struct ieee80211_hw *hw,
+                                    struct ieee80211_vif *vif)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+    struct mt7927_vif *mvif = (struct mt7927_vif *)vif->drv_priv;
+    int ret;
+
+    mutex_lock(&dev->mutex);
+
+    ret = mt7927_mcu_add_dev(dev, vif, false);
+    if (ret)
+        dev_warn(dev->dev, "Failed to remove interface %d from firmware: %d\n",
+                 mvif->idx, ret);
+
+    __clear_bit(mvif->bc_wcid, dev->wcid_mask);
+    dev->vif_mask &= ~BIT(mvif->idx);
+    mutex_unlock(&dev->mutex);
+}
+
+static int mt7927_config(struct ieee80211_hw *hw, int radio_idx, u32 changed)
+{
+    return 0;
+}
+
+static void mt7927_configure_filter(struct ieee80211_hw *hw,
+                                    unsigned int changed_flags,
+                                    unsigned int *total_flags, u64 multicast)
+{
+    *total_flags = 0;
+}
+
+/**
+ * mt7927_sta_amsdu_update - Apply the driver's A-MSDU size cap to a station
+ *
+ * Called with the wiphy and dev->mutex held.
+ */
+static void mt7927_sta_amsdu_update(struct mt7927_dev *dev,
+                                    struct ieee80211_sta *sta)
+{
+    sta->deflink.agg.max_rc_amsdu_len = dev->amsdu.max_len;
+    ieee80211_sta_recalc_aggregates(sta);
+}
+
+static int mt7927_sta_state(struct ieee80211_hw *hw, struct ieee80211_vif *vif,
+                            struct ieee80211_sta *sta,
+                            enum ieee80211_sta_state old_state,
+                            enum ieee80211_sta_state new_state)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+    struct mt7927_sta *msta = (struct mt7927_sta *)sta->drv_priv;
+    int idx, ret = 0;
+
+    mutex_lock(&dev->mutex);
+
+    if (old_state == IEEE80211_STA_NOTEXIST &&
+        new_state == IEEE80211_STA_NONE) {
+        idx = mt7927_wcid_alloc(dev);
+        if (idx < 0) {
+            ret = idx;
+            goto out;
+        }
+
+        msta->vif = (struct mt7927_vif *)vif->drv_priv;
+        msta->wcid = idx;
+        msta->txd_valid = false;
+
+        ret = mt7927_mcu_sta_update(dev, vif, sta, true,
+                                    CONN_STATE_DISCONNECT);
+        if (ret) {
+            __clear_bit(idx, dev->wcid_mask);
+            goto out;
+        }
+
+        rcu_assign_pointer(dev->wcid[idx], msta);
+    } else if (old_state == IEEE80211_STA_AUTH &&
+               new_state == IEEE80211_STA_ASSOC) {
+        /* QoS capability is final once the station has associated */
+        ret = mt7927_mcu_sta_update(dev, vif, sta, true, CONN_STATE_CONNECT);
+        if (ret)
+            goto out;
+
+        mt7927_mac_sta_txd_init(dev, sta);
+        mt7927_sta_amsdu_update(dev, sta);
+    } else if (old_state == IEEE80211_STA_ASSOC &&
+               new_state == IEEE80211_STA_AUTHORIZED) {
+        ret = mt7927_mcu_sta_update(dev, vif, sta, true,
+                                    CONN_STATE_PORT_SECURE);
+    } else if (old_state == IEEE80211_STA_NONE &&
+               new_state == IEEE80211_STA_NOTEXIST) {
+        ret = mt7927_mcu_sta_update(dev, vif, sta, false, 0);
+        if (ret)
+            dev_warn(dev->dev, "Failed to remove station %u from firmware: %d\n",
+                     msta->wcid, ret);
+        ret = 0;
+
+        /* Unpublished in sta_pre_rcu_remove, a grace period ago */
+        __clear_bit(msta->wcid, dev->wcid_mask);
+    }
+
+out:
+    mutex_unlock(&dev->mutex);
+
+    return ret;
+}
+
+/*
+ * mt7927_sta_pre_rcu_remove - Unpublish a station before mac80211 frees it
+ *
+ * mac80211 waits for a grace period after this and before NOTEXIST, so
+ * RX and TX completion, which look stations up under RCU, are done with
+ * it by the time it is freed.
+ */
+static void mt7927_sta_pre_rcu_remove(struct ieee80211_hw *hw,
+                                      struct ieee80211_vif *vif,
+                                      struct ieee80211_sta *sta)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+    struct mt7927_sta *msta = (struct mt7927_sta *)sta->drv_priv;
+
+    mutex_lock(&dev->mutex);
+    rcu_assign_pointer(dev->wcid[msta->wcid], NULL);
+    mutex_unlock(&dev->mutex);
+}
+
+/**
+ * mt7927_set_amsdu_max_len - Cap the A-MSDU size towards every station
+ * @dev: device structure
+ * @len: bytes, 0 for whatever the peer negotiated
+ */
+void mt7927_set_amsdu_max_len(struct mt7927_dev *dev, u32 len)
+{
+    struct mt7927_sta *msta;
+    int i;
+
+    wiphy_lock(dev->hw->wiphy);
+    mutex_lock(&dev->mutex);
+
+    dev->amsdu.max_len = len;
+    for (i = 0; i < MT7927_WTBL_SIZE; i++) {
+        msta = rcu_dereference_protected(dev->wcid[i],
+                                         lockdep_is_held(&dev->mutex));
+        if (msta)
+            mt7927_sta_amsdu_update(dev,
+                                    container_of((void *)msta,
+                                                 struct ieee80211_sta,
+                                                 drv_priv));
+    }
+
+    mutex_unlock(&dev->mutex);
+    wiphy_unlock(dev->hw->wiphy);
+}
+
+static void mt7927_sta_set_decap_offload(struct ieee80211_hw *hw,
+                                         struct ieee80211_vif *vif,
+                                         struct ieee80211_sta *sta,
+                                         bool enabled)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+    struct mt7927_sta *msta = (struct mt7927_sta *)sta->drv_priv;
+    int ret;
+
+    /* Also gates which 802.3 frames the RX path hands to mac80211 */
+    WRITE_ONCE(msta->decap, enabled);
+
+    mutex_lock(&dev->mutex);
+    ret = mt7927_mcu_sta_update_hdr_trans(dev, vif, sta);
+    mutex_unlock(&dev->mutex);
+
+    if (ret)
+        dev_warn(dev->dev, "Failed to update header translation: %d\n", ret);
+}
+
+static void mt7927_update_vif_offload(struct ieee80211_hw *hw,
+                                      struct ieee80211_vif *vif)
+{
+    struct mt7927_dev *dev = mt7927_hw_dev(hw);
+
+    /* Software A-MSDU needs the frames in 802.11 form */
+    if (READ_ONCE(dev->amsdu.enable))
+        vif->offload_flags &= ~IEEE80211_OFFLOAD_ENCAP_ENABLED;
+}
+
+static const struct ieee80211_ops mt7927_ops = {
+    .tx = mt7927_ops_tx,
+    .wake_tx_queue = mt7927_wake_tx_queue,
+    .start = mt7927_start,
+    .stop = mt7927_stop,
+    .add_interface = mt7927_add_interface,
+    .remove_interface = mt7927_remove_interface,
+    .config = mt7927_config,
+    .configure_filter = mt7927_configure_filter,
+    .sta_state = mt7927_sta_state,
+    .sta_pre_rcu_remove = mt7927_sta_pre_rcu_remove,
+    .sta_set_decap_offload = mt7927_sta_set_decap_offload,
+    .update_vif_offload = mt7927_update_vif_offload,
+};
+
+/* ============================================
+ * Registration
+ * ============================================ */
+
+static void mt7927_free_hw(void *hw)
+{
+    ieee80211_free_hw(hw);
+}
+
+/**
+ * mt7927_alloc_device - Allocate the ieee80211_hw that embeds mt7927_dev
+ *
+ * Freed automatically when the PCI device is unbound.
+ */
+struct mt7927_dev *mt7927_alloc_device(struct pci_dev *pdev)
+{
+    struct ieee80211_hw *hw;
+    struct mt7927_dev *dev;
+
+    hw = ieee80211_alloc_hw(sizeof(*dev), &mt7927_ops);
+    if (!hw)
+        return NULL;
+
+    if (devm_add_action_or_reset(&pdev->dev, mt7927_free_hw, hw))
+        return NULL;
+
+    dev = hw->priv;
+    dev->hw = hw;
+    INIT_WORK(&dev->tx_work, mt7927_tx_work);
+    dev->amsdu.enable = tx_amsdu;
+
+    return dev;
+}
+
+/**
+ * mt7927_register_device - Register with mac80211 once firmware runs
+ */
+int mt7927_register_device(struct mt7927_dev *dev)
+{
+    struct ieee80211_hw *hw = dev->hw;
+    struct wiphy *wiphy = hw->wiphy;
+    int ret;
+
+    SET_IEEE80211_DEV(hw, dev->dev);
+
+    /* Without one from the firmware, use a random, locally administered one */
+    if (!is_valid_ether_addr(dev->macaddr)) {
+        eth_random_addr(dev->macaddr);
+        dev_info(dev->dev, "Using random MAC address %pM\n", dev->macaddr);
+    }
+    SET_IEEE80211_PERM_ADDR(hw, dev->macaddr);
+
+    ret = mt7927_init_bands(dev);
+    if (ret)
+        return ret;
+
+    hw->queues = IEEE80211_NUM_ACS;
+    hw->vif_data_size = sizeof(struct mt7927_vif);
+    hw->sta_data_size = sizeof(struct mt7927_sta);
+    hw->max_rates = 1;
+    hw->max_report_rates = 1;
+
+    wiphy->interface_modes = BIT(NL80211_IFTYPE_STATION);
+    wiphy->available_antennas_tx = dev->nic_cap.valid ?
+                                   dev->nic_cap.antenna_mask : 0x3;
+    wiphy->available_antennas_rx = wiphy->available_antennas_tx;
+
+    /* Airtime fairness and AQL between stations, fq_codel inside each */
+    wiphy_ext_feature_set(wiphy, NL80211_EXT_FEATURE_AIRTIME_FAIRNESS);
+    wiphy_ext_feature_set(wiphy, NL80211_EXT_FEATURE_AQL);
+
+    ieee80211_hw_set(hw, SIGNAL_DBM);
+    ieee80211_hw_set(hw, HAS_RATE_CONTROL);
+
+    /*
+     * With encap offload the chip builds the 802.11 header from the
+     * station's WTBL entry; mt7927_mcu_sta_update() programs the header
+     * translation fields of that entry (STA_REC_HDR_TRANS).
+     */
+    ieee80211_hw_set(hw, SUPPORTS_TX_ENCAP_OFFLOAD);
+    ieee80211_hw_set(hw, SUPPORTS_RX_DECAP_OFFLOAD);
+
+    /*
+     * Otherwise mac80211 chains small frames of one station/TID into an
+     * A-MSDU on the skb frag_list; the data ring sends every subframe as
+     * its own DMA segment, so nothing is copied.
+     */
+    ieee80211_hw_set(hw, TX_AMSDU);
+    ieee80211_hw_set(hw, TX_FRAG_LIST);
+    hw->max_tx_fragments = MT7927_TX_AMSDU_MAX_SUBFRAMES;
+
+    /* The RXD reports hardware-validated IP/TCP/UDP checksums */
+    hw->netdev_features = NETIF_F_RXCSUM;
+
+    ret = ieee80211_register_hw(hw);
+    if (ret) {
+        dev_err(dev->dev, "Failed to register with mac80211: %d\n", ret);
+        return ret;
+    }
+
+    dev_info(dev->dev, "Registered %s\n", wiphy_name(wiphy));
+
+    return 0;
+}
+
+/**
+ * mt7927_unregister_device - Detach from mac80211
+ *
+ * mac80211 stops the device, which cancels the TX work.
+ */
+void mt7927_unregister_device(struct mt7927_dev *dev)
+{
+    ieee80211_unregister_hw(dev->hw);
+}
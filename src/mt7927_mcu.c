@@ -8,28 +8,467 @@
  */
 
 #include <linux/skbuff.h>
+#include <linux/etherdevice.h>
 #include <linux/firmware.h>
 #include <linux/delay.h>
+#include <linux/crc32.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
 
 #include "mt7927.h"
 #include "mt7927_mcu.h"
 
-/* Maximum firmware chunk size for scatter command */
-#define MT7927_FW_CHUNK_SIZE    (64 * 1024)
+/* ============================================
+ * Sequence Table
+ * ============================================ */
+
+/**
+ * mt7927_mcu_seq_try_get - Claim a free sequence number
+ *
+ * Returns: sequence (1..15) or 0 if all are in flight or still stale.
+ */
+static int mt7927_mcu_seq_try_get(struct mt7927_dev *dev, int cmd)
+{
+    struct mt7927_mcu_req *req;
+    unsigned long flags;
+    int i, seq = 0;
+
+    spin_lock_irqsave(&dev->mcu.lock, flags);
+
+    for (i = 0; i < MT7927_MCU_SEQ_NUM; i++) {
+        int s = (dev->mcu.seq + i) & 0xf;
+
+        if (!s)
+            continue;
+
+        req = &dev->mcu.req[s];
+        if (req->state == MT7927_MCU_REQ_STALE &&
+            time_after(jiffies, req->stale_until)) {
+            dev_kfree_skb_any(req->skb);
+            req->skb = NULL;
+            req->state = MT7927_MCU_REQ_FREE;
+        }
+
+        if (req->state != MT7927_MCU_REQ_FREE)
+            continue;
+
+        reinit_completion(&req->done);
+        req->skb = NULL;
+        req->cmd = cmd;
+        req->state = MT7927_MCU_REQ_WAITING;
+        dev->mcu.seq = (s + 1) & 0xf;
+        seq = s;
+        break;
+    }
+
+    spin_unlock_irqrestore(&dev->mcu.lock, flags);
+
+    return seq;
+}
+
+/**
+ * mt7927_mcu_seq_get - Claim a sequence number, waiting for one if needed
+ */
+static int mt7927_mcu_seq_get(struct mt7927_dev *dev, int cmd)
+{
+    int seq = 0;
+
+    if (!wait_event_timeout(dev->mcu.wait,
+                            (seq = mt7927_mcu_seq_try_get(dev, cmd)) != 0,
+                            dev->mcu.timeout)) {
+        dev_err(dev->dev, "No free MCU sequence for command 0x%04x\n", cmd);
+        return -EBUSY;
+    }
+
+    return seq;
+}
+
+/**
+ * mt7927_mcu_seq_put - Release a sequence number
+ * @stale: the response may still arrive; keep the slot out of use until
+ *         it does or until one more MCU timeout has passed
+ */
+static void mt7927_mcu_seq_put(struct mt7927_dev *dev, int seq, bool stale)
+{
+    struct mt7927_mcu_req *req = &dev->mcu.req[seq];
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->mcu.lock, flags);
+    if (stale) {
+        req->state = MT7927_MCU_REQ_STALE;
+        req->stale_until = jiffies + dev->mcu.timeout;
+    } else {
+        req->state = MT7927_MCU_REQ_FREE;
+    }
+    spin_unlock_irqrestore(&dev->mcu.lock, flags);
+
+    wake_up(&dev->mcu.wait);
+}
+
+/* ============================================
+ * Latency Accounting
+ * ============================================ */
+
+/*
+ * mt7927_mcu_lat_slot - Find or claim the statistics slot for @cmd
+ *
+ * Slots are claimed with cmpxchg and never released, so lookups are
+ * lock-free from any context. Returns -1 once all slots are taken.
+ */
+static int mt7927_mcu_lat_slot(struct mt7927_dev *dev, int cmd)
+{
+    u32 key = (u32)cmd | MT7927_MCU_LAT_KEY_VALID;
+    u32 cur;
+    int i;
+
+    for (i = 0; i < MT7927_MCU_LAT_SLOTS; i++) {
+        cur = READ_ONCE(dev->mcu.lat_key[i]);
+        if (!cur)
+            cur = cmpxchg(&dev->mcu.lat_key[i], 0, key) ?: key;
+        if (cur == key)
+            return i;
+    }
+
+    return -1;
+}
+
+static void mt7927_mcu_lat_record(struct mt7927_dev *dev, int cmd,
+                                  enum mt7927_mcu_lat_type type, u64 start_ns)
+{
+    u64 us;
+    int slot, bucket;
+
+    if (!dev->mcu.lat || !start_ns)
+        return;
+
+    us = div_u64(ktime_get_ns() - start_ns, NSEC_PER_USEC);
+    bucket = us ? min_t(int, ilog2(us) + 1, MT7927_MCU_LAT_BUCKETS - 1) : 0;
+
+    slot = mt7927_mcu_lat_slot(dev, cmd);
+    if (slot < 0)
+        this_cpu_inc(dev->mcu.lat->untracked);
+    else
+        this_cpu_inc(dev->mcu.lat->slot[slot].hist[type][bucket]);
+}
+
+static void mt7927_mcu_lat_timeout(struct mt7927_dev *dev, int cmd)
+{
+    int slot;
+
+    if (!dev->mcu.lat)
+        return;
+
+    slot = mt7927_mcu_lat_slot(dev, cmd);
+    if (slot < 0)
+        this_cpu_inc(dev->mcu.lat->untracked);
+    else
+        this_cpu_inc(dev->mcu.lat->slot[slot].timeouts);
+}
+
+/**
+ * mt7927_mcu_tx_done - Account an MCU message whose TX DMA completed
+ *
+ * Called from TX completion on the MCU rings, before the skb is freed.
+ */
+void mt7927_mcu_tx_done(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    struct mt7927_mcu_cb *cb = MT7927_MCU_CB(skb);
+
+    mt7927_mcu_lat_record(dev, cb->cmd, MT7927_MCU_LAT_DMA, cb->enqueue_ns);
+}
+
+/**
+ * mt7927_mcu_wait_response - Wait for the response to @seq
+ * @dev: device structure
+ * @seq: sequence claimed with mt7927_mcu_seq_get()
+ * @cmd: command ID (for logging)
+ * @ret_skb: response, owned by the caller on success
+ */
+static int mt7927_mcu_wait_response(struct mt7927_dev *dev, int seq, int cmd,
+                                    struct sk_buff **ret_skb)
+{
+    struct mt7927_mcu_req *req = &dev->mcu.req[seq];
+    struct mt7927_queue *rxq = &dev->rx_q[MT7927_RXQ_MCU_WM];
+    struct mt7927_compl *c = &rxq->compl;
+    unsigned long deadline = jiffies + dev->mcu.timeout;
+    enum mt7927_compl_by by = MT7927_COMPL_BY_TIMEOUT;
+    ktime_t start = ktime_get();
+    u32 spin = mt7927_compl_begin(c);
+    struct sk_buff *skb;
+    unsigned long flags;
+    long ret = 0;
+
+    /* Reap the response ring ourselves for a short window first */
+    while (ktime_us_delta(ktime_get(), start) < spin) {
+        if (try_wait_for_completion(&req->done)) {
+            by = MT7927_COMPL_BY_POLL;
+            ret = 1;
+            break;
+        }
+        if (!time_before(jiffies, deadline))
+            break;
+
+        mt7927_rx_poll(dev, rxq, 16);
+
+        if (c->mode == MT7927_COMPL_POLL)
+            usleep_range(20, 50);
+        else
+            cpu_relax();
+    }
+
+    if (!ret && c->mode != MT7927_COMPL_POLL) {
+        ret = wait_for_completion_timeout(&req->done,
+                                          max_t(long, deadline - jiffies, 1));
+        if (ret)
+            by = MT7927_COMPL_BY_IRQ;
+    }
+
+    mt7927_compl_end(c, start, by);
+
+    spin_lock_irqsave(&dev->mcu.lock, flags);
+    skb = req->skb;
+    req->skb = NULL;
+    spin_unlock_irqrestore(&dev->mcu.lock, flags);
+
+    if (!skb) {
+        /* Completed without a response: aborted by mt7927_mcu_exit() */
+        mt7927_mcu_seq_put(dev, seq, !ret);
+        if (ret)
+            return -ESHUTDOWN;
+
+        dev_err(dev->dev, "MCU command 0x%04x timeout (seq %d)\n", cmd, seq);
+        mt7927_mcu_lat_timeout(dev, cmd);
+        if (mt7927_chip_is_dead(dev))
+            mt7927_reset(dev);
+        return -ETIMEDOUT;
+    }
+
+    mt7927_mcu_seq_put(dev, seq, false);
+
+    if (ret_skb)
+        *ret_skb = skb;
+    else
+        dev_kfree_skb(skb);
+
+    return 0;
+}
+
+/* ============================================
+ * Event Dispatch
+ * ============================================ */
+
+static void mt7927_mcu_event_fw_ready(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    dev_info(dev->dev, "MCU event: firmware ready\n");
+}
+
+static void mt7927_mcu_event_restart_dl(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    dev_warn(dev->dev, "MCU event: firmware requested re-download\n");
+
+    if (dev->mcu.state == MT7927_MCU_STATE_RUNNING)
+        mt7927_reset(dev);
+}
+
+static void mt7927_mcu_event_generic(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    struct mt7927_mcu_rxd *rxd = (struct mt7927_mcu_rxd *)skb->data;
+
+    dev_dbg(dev->dev, "MCU event: generic (ext_eid 0x%02x, %u bytes)\n",
+            rxd->ext_eid, skb->len);
+}
+
+static void mt7927_mcu_event_work(struct work_struct *work)
+{
+    struct mt7927_dev *dev = container_of(work, struct mt7927_dev,
+                                          mcu.event_work);
+    struct mt7927_mcu_rxd *rxd;
+    struct sk_buff *skb;
+
+    while ((skb = skb_dequeue(&dev->mcu.event_q)) != NULL) {
+        rxd = (struct mt7927_mcu_rxd *)skb->data;
+
+        if (dev->mcu.events[rxd->eid].handler) {
+            dev->mcu.events[rxd->eid].handler(dev, skb);
+        } else {
+            dev->mcu.event_unhandled++;
+            dev_dbg(dev->dev, "Unhandled MCU event 0x%02x (seq %d)\n",
+                    rxd->eid, rxd->seq);
+        }
+
+        dev_kfree_skb(skb);
+    }
+}
+
+/**
+ * mt7927_mcu_queue_event - Defer an unsolicited event to the event workqueue
+ *
+ * Never drops: the backlog is unbounded and its high-water mark is kept
+ * so a firmware notification storm shows up in debugfs.
+ */
+static void mt7927_mcu_queue_event(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    struct mt7927_mcu_rxd *rxd = (struct mt7927_mcu_rxd *)skb->data;
+    u32 backlog;
+
+    dev->mcu.events[rxd->eid].count++;
+
+    skb_queue_tail(&dev->mcu.event_q, skb);
+    backlog = skb_queue_len(&dev->mcu.event_q);
+    if (backlog > dev->mcu.event_backlog_max)
+        dev->mcu.event_backlog_max = backlog;
+
+    queue_work(dev->mcu.event_wq, &dev->mcu.event_work);
+}
+
+/**
+ * mt7927_mcu_register_event - Install the handler for an event ID
+ */
+void mt7927_mcu_register_event(struct mt7927_dev *dev, u8 eid,
+                               mt7927_mcu_event_fn handler)
+{
+    WRITE_ONCE(dev->mcu.events[eid].handler, handler);
+}
+
+/**
+ * mt7927_mcu_event_init - Set up event dispatch (once, at probe)
+ */
+int mt7927_mcu_event_init(struct mt7927_dev *dev)
+{
+    skb_queue_head_init(&dev->mcu.event_q);
+    INIT_WORK(&dev->mcu.event_work, mt7927_mcu_event_work);
+
+    dev->mcu.event_wq = alloc_ordered_workqueue("mt7927-mcu-event",
+                                                WQ_HIGHPRI | WQ_MEM_RECLAIM);
+    if (!dev->mcu.event_wq)
+        return -ENOMEM;
+
+    mt7927_mcu_register_event(dev, MCU_EVENT_FW_READY, mt7927_mcu_event_fw_ready);
+    mt7927_mcu_register_event(dev, MCU_EVENT_RESTART_DL, mt7927_mcu_event_restart_dl);
+    mt7927_mcu_register_event(dev, MCU_EVENT_GENERIC, mt7927_mcu_event_generic);
+
+    return 0;
+}
+
+/**
+ * mt7927_mcu_event_exit - Tear down event dispatch (at remove)
+ */
+void mt7927_mcu_event_exit(struct mt7927_dev *dev)
+{
+    if (!dev->mcu.event_wq)
+        return;
+
+    cancel_work_sync(&dev->mcu.event_work);
+    destroy_workqueue(dev->mcu.event_wq);
+    dev->mcu.event_wq = NULL;
+    skb_queue_purge(&dev->mcu.event_q);
+}
+
+/**
+ * mt7927_mcu_rx_event - Demultiplex an RX skb from the MCU ring
+ *
+ * Called from the RX path in atomic context. Responses are matched on
+ * rxd->seq and completed inline so they never queue behind events; late
+ * responses to retired sequences are dropped and free their slot.
+ * Everything else is an unsolicited event for the event workqueue.
+ */
+void mt7927_mcu_rx_event(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    struct mt7927_mcu_rxd *rxd = (struct mt7927_mcu_rxd *)skb->data;
+    struct mt7927_mcu_req *req;
+    unsigned long flags;
+    int seq = rxd->seq & 0xf;
+
+    if (skb->len < sizeof(*rxd)) {
+        dev_dbg(dev->dev, "Runt MCU event (%u bytes) dropped\n", skb->len);
+        dev_kfree_skb_any(skb);
+        return;
+    }
+
+    if (!seq)
+        goto event;
+
+    req = &dev->mcu.req[seq];
+
+    spin_lock_irqsave(&dev->mcu.lock, flags);
+
+    if (req->state == MT7927_MCU_REQ_WAITING && !req->skb) {
+        mt7927_mcu_lat_record(dev, req->cmd, MT7927_MCU_LAT_RESP,
+                              req->sent_ns);
+        req->skb = skb;
+        complete(&req->done);
+        spin_unlock_irqrestore(&dev->mcu.lock, flags);
+        return;
+    }
+
+    dev->mcu.seq_mismatch++;
+
+    if (req->state == MT7927_MCU_REQ_STALE) {
+        req->state = MT7927_MCU_REQ_FREE;
+        spin_unlock_irqrestore(&dev->mcu.lock, flags);
+        dev_dbg(dev->dev, "Late MCU response for seq %d (cmd 0x%04x) dropped\n",
+                seq, req->cmd);
+        wake_up(&dev->mcu.wait);
+        dev_kfree_skb_any(skb);
+        return;
+    }
+
+    spin_unlock_irqrestore(&dev->mcu.lock, flags);
+
+event:
+    mt7927_mcu_queue_event(dev, skb);
+}
 
 /* ============================================
  * MCU Message Operations
  * ============================================ */
 
+/*
+ * mt7927_mcu_fill_uni_message - Fill the header of a UNI command
+ *
+ * UNI commands carry a 16-bit CID and an option byte in place of the
+ * legacy cid/ext_cid pair. There is no WA on this chip, so MCU_WM_UNI_CMD()
+ * and MCU_UNI_CMD() both go host-to-WM.
+ */
+static int mt7927_mcu_fill_uni_message(struct mt7927_dev *dev,
+                                       struct sk_buff *skb, int cmd, int seq)
+{
+    struct mt7927_mcu_uni_txd *txd;
+    u32 val;
+    u8 option = MCU_UNI_OPT_UNI;
+
+    txd = (struct mt7927_mcu_uni_txd *)skb_push(skb, sizeof(*txd));
+    memset(txd, 0, sizeof(*txd));
+
+    val = FIELD_PREP(MT_TXD0_TX_BYTES, skb->len) |
+          FIELD_PREP(MT_TXD0_PKT_FMT, MT_PKT_TYPE_CMD);
+    txd->txd[0] = cpu_to_le32(val);
+
+    if (seq)
+        option |= MCU_UNI_OPT_ACK;
+    if (!(cmd & MCU_CMD_FIELD_QUERY))
+        option |= MCU_UNI_OPT_SET;
+
+    txd->len = cpu_to_le16(skb->len - sizeof(txd->txd));
+    txd->cid = cpu_to_le16(MCU_CMD_ID(cmd));
+    txd->pkt_type = MCU_PKT_ID;
+    txd->seq = seq;
+    txd->s2d_index = S2D_IDX_MCU;
+    txd->option = option;
+
+    return 0;
+}
+
 /**
  * mt7927_mcu_fill_message - Fill MCU message header
  * @dev: device structure
  * @skb: SKB containing the message data
  * @cmd: command ID
- * @seq: pointer to store sequence number
+ * @seq: sequence number from the sequence table (0 if no response is wanted)
  */
 int mt7927_mcu_fill_message(struct mt7927_dev *dev, struct sk_buff *skb,
-                            int cmd, int *seq)
+                            int cmd, int seq)
 {
     struct mt7927_mcu_txd *txd;
     u32 val;
@@ -38,14 +477,13 @@ int mt7927_mcu_fill_message(struct mt7927_dev *dev, struct sk_buff *skb,
     int cmd_id = MCU_CMD_ID(cmd);
     int ext_id = MCU_CMD_EXT_ID(cmd);
 
+    if (cmd & MCU_CMD_FIELD_UNI)
+        return mt7927_mcu_fill_uni_message(dev, skb, cmd, seq);
+
     /* Reserve space for header */
     txd = (struct mt7927_mcu_txd *)skb_push(skb, sizeof(*txd));
     memset(txd, 0, sizeof(*txd));
 
-    /* Get sequence number */
-    *seq = dev->mcu.seq++;
-    dev->mcu.seq &= 0xf;  /* 4-bit sequence number */
-
     /* Set TX descriptor word 0 */
     val = FIELD_PREP(MT_TXD0_TX_BYTES, skb->len) |
           FIELD_PREP(MT_TXD0_PKT_FMT, pkt_type);
@@ -56,8 +494,8 @@ int mt7927_mcu_fill_message(struct mt7927_dev *dev, struct sk_buff *skb,
     txd->pq_id = cpu_to_le16(0x8000);  /* Priority queue ID */
     txd->cid = cmd_id;
     txd->pkt_type = pkt_type;
-    txd->set_query = MCU_SET;
-    txd->seq = *seq;
+    txd->set_query = (cmd & MCU_CMD_FIELD_QUERY) ? MCU_QUERY : MCU_SET;
+    txd->seq = seq;
 
     if (cmd & MCU_CMD_FIELD_EXT_ID) {
         txd->ext_cid = ext_id;
@@ -69,6 +507,48 @@ int mt7927_mcu_fill_message(struct mt7927_dev *dev, struct sk_buff *skb,
     return 0;
 }
 
+/**
+ * mt7927_mcu_msg_alloc - Allocate an MCU message with room for the TXD
+ * @dev: device structure
+ * @data: initial payload (may be NULL)
+ * @len: payload capacity; @data, if given, is copied in full
+ */
+struct sk_buff *mt7927_mcu_msg_alloc(struct mt7927_dev *dev,
+                                     const void *data, int len)
+{
+    struct sk_buff *skb;
+
+    skb = alloc_skb(len + MT_MCU_HDR_SIZE + 32, GFP_KERNEL);
+    if (!skb)
+        return NULL;
+
+    skb_reserve(skb, MT_MCU_HDR_SIZE + 16);
+
+    if (data && len > 0)
+        skb_put_data(skb, data, len);
+
+    return skb;
+}
+
+/**
+ * mt7927_mcu_add_tlv - Append a zeroed TLV to a UNI message
+ * @skb: message sized by the caller to hold the TLV
+ * @tag: TLV tag
+ * @len: TLV length including the tag/length header
+ *
+ * Returns a pointer to the TLV for the caller to fill in place.
+ */
+void *mt7927_mcu_add_tlv(struct sk_buff *skb, u16 tag, u16 len)
+{
+    struct mt7927_uni_tlv *tlv;
+
+    tlv = skb_put_zero(skb, len);
+    tlv->tag = cpu_to_le16(tag);
+    tlv->len = cpu_to_le16(len);
+
+    return tlv;
+}
+
 /**
  * mt7927_mcu_send_msg - Send MCU message
  * @dev: device structure
@@ -80,391 +560,1939 @@ int mt7927_mcu_fill_message(struct mt7927_dev *dev, struct sk_buff *skb,
 int mt7927_mcu_send_msg(struct mt7927_dev *dev, int cmd,
                         const void *data, int len, bool wait_resp)
 {
-    struct sk_buff *skb = NULL;
+    return mt7927_mcu_send_and_get_msg(dev, cmd, data, len, wait_resp, NULL);
+}
 
-    return mt7927_mcu_send_and_get_msg(dev, cmd, data, len, wait_resp, &skb);
+/*
+ * mt7927_mcu_uni_has_status - Whether a UNI command answers with its result
+ *
+ * Configuration commands answer with a command-result event; queries such
+ * as CHIP_CONFIG answer with their data instead.
+ */
+static bool mt7927_mcu_uni_has_status(int cmd)
+{
+    if (!(cmd & MCU_CMD_FIELD_UNI) || (cmd & MCU_CMD_FIELD_QUERY))
+        return false;
+
+    switch (MCU_CMD_ID(cmd)) {
+    case MCU_UNI_CMD_DEV_INFO_UPDATE:
+    case MCU_UNI_CMD_BSS_INFO_UPDATE:
+    case MCU_UNI_CMD_STA_REC_UPDATE:
+    case MCU_UNI_CMD_SUSPEND:
+    case MCU_UNI_CMD_OFFLOAD:
+    case MCU_UNI_CMD_HIF_CTRL:
+        return true;
+    default:
+        return false;
+    }
 }
 
-/**
- * mt7927_mcu_send_and_get_msg - Send MCU message and get response
- * @dev: device structure
- * @cmd: command ID
- * @data: message data
- * @len: data length
- * @wait_resp: wait for response
- * @ret_skb: pointer to store response SKB
+/*
+ * mt7927_mcu_uni_status - Check the result a UNI command answered with
+ *
+ * The response echoes the CID of the command it answers and carries the
+ * firmware status; anything else means the command was not applied.
  */
-int mt7927_mcu_send_and_get_msg(struct mt7927_dev *dev, int cmd,
-                                const void *data, int len,
-                                bool wait_resp, struct sk_buff **ret_skb)
+static int mt7927_mcu_uni_status(struct mt7927_dev *dev, int cmd,
+                                 struct sk_buff *skb)
 {
-    struct mt7927_queue *q;
-    struct sk_buff *skb;
-    int ret, seq;
+    struct mt7927_mcu_uni_event *event;
 
-    /* Allocate SKB for message */
-    skb = alloc_skb(len + MT_MCU_HDR_SIZE + 32, GFP_KERNEL);
-    if (!skb)
-        return -ENOMEM;
+    if (skb->len < sizeof(struct mt7927_mcu_rxd) + sizeof(*event)) {
+        dev_err(dev->dev, "MCU command 0x%04x: short response (%u bytes)\n",
+                cmd, skb->len);
+        return -EIO;
+    }
 
-    skb_reserve(skb, MT_MCU_HDR_SIZE + 16);
+    event = (struct mt7927_mcu_uni_event *)(skb->data +
+                                            sizeof(struct mt7927_mcu_rxd));
+    if (event->cid != (u8)MCU_CMD_ID(cmd) || le32_to_cpu(event->status)) {
+        dev_err(dev->dev, "MCU command 0x%04x failed: cid 0x%02x status %u\n",
+                cmd, event->cid, le32_to_cpu(event->status));
+        return -EIO;
+    }
 
-    /* Copy data to SKB */
-    if (data && len > 0)
-        skb_put_data(skb, data, len);
+    return 0;
+}
 
-    /* Fill message header */
-    ret = mt7927_mcu_fill_message(dev, skb, cmd, &seq);
-    if (ret) {
-        dev_kfree_skb(skb);
+/*
+ * mt7927_mcu_wait_result - Wait for @seq and check the command result
+ *
+ * Releases @seq in all cases. The response is handed to @ret_skb, if
+ * given, only when the command succeeded.
+ */
+static int mt7927_mcu_wait_result(struct mt7927_dev *dev, int seq, int cmd,
+                                  struct sk_buff **ret_skb)
+{
+    struct sk_buff *skb;
+    int ret;
+
+    ret = mt7927_mcu_wait_response(dev, seq, cmd, &skb);
+    if (ret)
         return ret;
+
+    if (mt7927_mcu_uni_has_status(cmd))
+        ret = mt7927_mcu_uni_status(dev, cmd, skb);
+
+    if (!ret && ret_skb)
+        *ret_skb = skb;
+    else
+        dev_kfree_skb(skb);
+
+    return ret;
+}
+
+/*
+ * mt7927_mcu_queue_msg - Fill the header of @skb and put it on its ring
+ *
+ * Consumes @skb. Returns the sequence to wait on (0 if @wait_resp is
+ * false) or a negative error. Caller holds a runtime PM reference.
+ */
+static int mt7927_mcu_queue_msg(struct mt7927_dev *dev, struct sk_buff *skb,
+                                int cmd, bool wait_resp)
+{
+    struct mt7927_queue *q;
+    int ret, seq = 0;
+
+    /* Select queue based on command */
+    if (cmd == MCU_CMD(MCU_CMD_FW_SCATTER))
+        q = dev->q_mcu[MT_MCUQ_FWDL];
+    else
+        q = dev->q_mcu[MT_MCUQ_WM];
+
+    if (!q) {
+        dev_err(dev->dev, "MCU queue not initialized\n");
+        dev_kfree_skb(skb);
+        return -EINVAL;
+    }
+
+    /* Only commands we wait on take a slot in the sequence table */
+    if (wait_resp) {
+        seq = mt7927_mcu_seq_get(dev, cmd);
+        if (seq < 0) {
+            dev_kfree_skb(skb);
+            return seq;
+        }
+    }
+
+    /* Fill message header */
+    ret = mt7927_mcu_fill_message(dev, skb, cmd, seq);
+    if (ret)
+        goto err_free;
+
+    /* Latency is measured from here; the skb is not ours after queueing */
+    MT7927_MCU_CB(skb)->cmd = cmd;
+    MT7927_MCU_CB(skb)->enqueue_ns = ktime_get_ns();
+    if (seq)
+        dev->mcu.req[seq].sent_ns = MT7927_MCU_CB(skb)->enqueue_ns;
+
+    /* Queue the message */
+    ret = mt7927_tx_queue_skb(dev, q, skb);
+    if (ret) {
+        dev_err(dev->dev, "Failed to queue MCU message: %d\n", ret);
+        goto err_free;
+    }
+
+    return seq;
+
+err_free:
+    if (seq)
+        mt7927_mcu_seq_put(dev, seq, false);
+    dev_kfree_skb(skb);
+    return ret;
+}
+
+/*
+ * __mt7927_mcu_skb_send_msg - Send a prebuilt MCU message and get response
+ *
+ * Consumes @skb. Caller holds a runtime PM reference.
+ */
+static int __mt7927_mcu_skb_send_msg(struct mt7927_dev *dev,
+                                     struct sk_buff *skb, int cmd,
+                                     bool wait_resp, struct sk_buff **ret_skb)
+{
+    int seq;
+
+    seq = mt7927_mcu_queue_msg(dev, skb, cmd, wait_resp);
+    if (seq <= 0)
+        return seq;
+
+    return mt7927_mcu_wait_result(dev, seq, cmd, ret_skb);
+}
+
+/**
+ * mt7927_mcu_send_and_get_msg - Send MCU message and get response
+ * @dev: device structure
+ * @cmd: command ID
+ * @data: message data
+ * @len: data length
+ * @wait_resp: wait for response
+ * @ret_skb: pointer to store response SKB
+ */
+int mt7927_mcu_send_and_get_msg(struct mt7927_dev *dev, int cmd,
+                                const void *data, int len,
+                                bool wait_resp, struct sk_buff **ret_skb)
+{
+    struct sk_buff *skb;
+    int ret;
+
+    /* Keep the chip driver-owned until the response is in */
+    ret = mt7927_pm_get(dev);
+    if (ret)
+        return ret;
+
+    skb = mt7927_mcu_msg_alloc(dev, data, len);
+    if (skb)
+        ret = __mt7927_mcu_skb_send_msg(dev, skb, cmd, wait_resp, ret_skb);
+    else
+        ret = -ENOMEM;
+
+    mt7927_pm_put(dev);
+
+    return ret;
+}
+
+/**
+ * mt7927_mcu_skb_send_msg - Send a message built with mt7927_mcu_msg_alloc()
+ * @dev: device structure
+ * @skb: message payload; consumed in all cases
+ * @cmd: command ID
+ * @wait_resp: wait for response
+ */
+int mt7927_mcu_skb_send_msg(struct mt7927_dev *dev, struct sk_buff *skb,
+                            int cmd, bool wait_resp)
+{
+    int ret;
+
+    ret = mt7927_pm_get(dev);
+    if (ret) {
+        dev_kfree_skb(skb);
+        return ret;
+    }
+
+    ret = __mt7927_mcu_skb_send_msg(dev, skb, cmd, wait_resp, NULL);
+
+    mt7927_pm_put(dev);
+
+    return ret;
+}
+
+/* ============================================
+ * UNI Command Batching
+ * ============================================ */
+
+/* The command ID travels in the skb control block while a message is queued */
+#define MT7927_BATCH_CMD(skb)   (MT7927_MCU_CB(skb)->cmd)
+
+static void mt7927_mcu_batch_close(struct mt7927_mcu_batch *batch)
+{
+    if (!batch->skb)
+        return;
+
+    MT7927_BATCH_CMD(batch->skb) = batch->cmd;
+    __skb_queue_tail(&batch->msgs, batch->skb);
+    batch->skb = NULL;
+}
+
+static int mt7927_mcu_batch_open(struct mt7927_mcu_batch *batch, int cmd,
+                                 const void *hdr, int hdr_len)
+{
+    struct sk_buff *skb;
+
+    if (hdr_len > MT7927_UNI_MSG_MAX_PAYLOAD)
+        return -E2BIG;
+
+    skb = mt7927_mcu_msg_alloc(batch->dev, NULL, MT7927_UNI_MSG_MAX_PAYLOAD);
+    if (!skb)
+        return -ENOMEM;
+
+    if (hdr_len)
+        skb_put_data(skb, hdr, hdr_len);
+
+    batch->skb = skb;
+    batch->cmd = cmd;
+    batch->hdr_len = hdr_len;
+
+    return 0;
+}
+
+/**
+ * mt7927_mcu_batch_init - Prepare an empty batch
+ */
+void mt7927_mcu_batch_init(struct mt7927_dev *dev,
+                           struct mt7927_mcu_batch *batch)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->dev = dev;
+    __skb_queue_head_init(&batch->msgs);
+}
+
+/**
+ * mt7927_mcu_batch_begin - Start a new UNI command in the batch
+ * @batch: batch
+ * @cmd: UNI command, e.g. MCU_WM_UNI_CMD(MCU_UNI_CMD_STA_REC_UPDATE)
+ * @hdr: fixed command header preceding the TLVs (copied)
+ * @hdr_len: header length
+ */
+int mt7927_mcu_batch_begin(struct mt7927_mcu_batch *batch, int cmd,
+                           const void *hdr, int hdr_len)
+{
+    mt7927_mcu_batch_close(batch);
+
+    return mt7927_mcu_batch_open(batch, cmd, hdr, hdr_len);
+}
+
+/**
+ * mt7927_mcu_batch_add_tlv - Append a zeroed TLV to the current command
+ * @batch: batch with a command begun
+ * @tag: TLV tag
+ * @len: TLV length including the tag/length header
+ *
+ * Spills into a continuation message when the current one is full.
+ * Returns the TLV to fill in place or an ERR_PTR().
+ */
+void *mt7927_mcu_batch_add_tlv(struct mt7927_mcu_batch *batch,
+                               u16 tag, u16 len)
+{
+    struct sk_buff *prev = batch->skb;
+    int ret;
+
+    if (WARN_ON_ONCE(!prev))
+        return ERR_PTR(-EINVAL);
+
+    if (len < sizeof(struct mt7927_uni_tlv) ||
+        batch->hdr_len + len > MT7927_UNI_MSG_MAX_PAYLOAD)
+        return ERR_PTR(-E2BIG);
+
+    if (prev->len + len > MT7927_UNI_MSG_MAX_PAYLOAD) {
+        mt7927_mcu_batch_close(batch);
+        ret = mt7927_mcu_batch_open(batch, MT7927_BATCH_CMD(prev),
+                                    prev->data, batch->hdr_len);
+        if (ret)
+            return ERR_PTR(ret);
+    }
+
+    return mt7927_mcu_add_tlv(batch->skb, tag, len);
+}
+
+/**
+ * mt7927_mcu_batch_commit - Send every message in the batch
+ *
+ * Every message takes its own sequence and is acknowledged. Up to
+ * MT7927_MCU_BATCH_INFLIGHT messages are on the WM ring at once; the
+ * oldest response is collected before the next message is queued, so the
+ * firmware pipeline stays full without draining the sequence table. On the
+ * first failure nothing more is queued, but the responses already owed are
+ * still collected. The batch is empty on return.
+ */
+int mt7927_mcu_batch_commit(struct mt7927_mcu_batch *batch)
+{
+    struct {
+        int seq;
+        int cmd;
+    } inflight[MT7927_MCU_BATCH_INFLIGHT];
+    struct mt7927_dev *dev = batch->dev;
+    struct sk_buff *skb;
+    int head = 0, n = 0;
+    int ret, err;
+
+    mt7927_mcu_batch_close(batch);
+
+    if (skb_queue_empty(&batch->msgs))
+        return 0;
+
+    ret = mt7927_pm_get(dev);
+    if (ret) {
+        __skb_queue_purge(&batch->msgs);
+        return ret;
+    }
+
+    while (n || !skb_queue_empty(&batch->msgs)) {
+        if (!ret && n < MT7927_MCU_BATCH_INFLIGHT &&
+            (skb = __skb_dequeue(&batch->msgs)) != NULL) {
+            int cmd = MT7927_BATCH_CMD(skb);
+            int seq = mt7927_mcu_queue_msg(dev, skb, cmd, true);
+
+            if (seq < 0) {
+                ret = seq;
+            } else {
+                inflight[(head + n) % MT7927_MCU_BATCH_INFLIGHT].seq = seq;
+                inflight[(head + n) % MT7927_MCU_BATCH_INFLIGHT].cmd = cmd;
+                n++;
+            }
+            continue;
+        }
+
+        if (ret)
+            __skb_queue_purge(&batch->msgs);
+        if (!n)
+            break;
+
+        err = mt7927_mcu_wait_result(dev, inflight[head].seq,
+                                     inflight[head].cmd, NULL);
+        if (err && !ret) {
+            dev_err(dev->dev, "MCU batch aborted at cmd 0x%x: %d\n",
+                    inflight[head].cmd, err);
+            ret = err;
+        }
+        head = (head + 1) % MT7927_MCU_BATCH_INFLIGHT;
+        n--;
+    }
+
+    mt7927_pm_put(dev);
+
+    return ret;
+}
+
+/**
+ * mt7927_mcu_batch_abort - Discard a batch without sending it
+ */
+void mt7927_mcu_batch_abort(struct mt7927_mcu_batch *batch)
+{
+    if (batch->skb) {
+        dev_kfree_skb(batch->skb);
+        batch->skb = NULL;
+    }
+
+    __skb_queue_purge(&batch->msgs);
+}
+
+/* ============================================
+ * Interface Setup
+ * ============================================ */
+
+static int mt7927_mcu_dev_info(struct mt7927_mcu_batch *batch,
+                               struct ieee80211_vif *vif, bool enable)
+{
+    struct mt7927_vif *mvif = (struct mt7927_vif *)vif->drv_priv;
+    struct mt7927_dev_info_hdr hdr = {
+        .omac_idx = mvif->idx,
+        .band_idx = mvif->band_idx,
+    };
+    struct mt7927_dev_info_active_tlv *tlv;
+    int ret;
+
+    ret = mt7927_mcu_batch_begin(batch,
+                                 MCU_WM_UNI_CMD(MCU_UNI_CMD_DEV_INFO_UPDATE),
+                                 &hdr, sizeof(hdr));
+    if (ret)
+        return ret;
+
+    tlv = mt7927_mcu_batch_add_tlv(batch, UNI_DEV_INFO_ACTIVE, sizeof(*tlv));
+    if (IS_ERR(tlv))
+        return PTR_ERR(tlv);
+
+    tlv->active = enable;
+    memcpy(tlv->omac_addr, vif->addr, ETH_ALEN);
+
+    return 0;
+}
+
+static int mt7927_mcu_bss_basic(struct mt7927_mcu_batch *batch,
+                                struct ieee80211_vif *vif, bool enable)
+{
+    struct mt7927_vif *mvif = (struct mt7927_vif *)vif->drv_priv;
+    struct mt7927_bss_info_hdr hdr = {
+        .bss_idx = mvif->idx,
+    };
+    struct mt7927_bss_basic_tlv *tlv;
+    u32 conn_type;
+    int ret;
+
+    switch (vif->type) {
+    case NL80211_IFTYPE_AP:
+    case NL80211_IFTYPE_MESH_POINT:
+        conn_type = CONNECTION_INFRA_AP;
+        break;
+    case NL80211_IFTYPE_P2P_GO:
+        conn_type = CONNECTION_P2P_GO;
+        break;
+    case NL80211_IFTYPE_ADHOC:
+        conn_type = CONNECTION_IBSS_ADHOC;
+        break;
+    default:
+        conn_type = CONNECTION_INFRA_STA;
+        break;
+    }
+
+    ret = mt7927_mcu_batch_begin(batch,
+                                 MCU_WM_UNI_CMD(MCU_UNI_CMD_BSS_INFO_UPDATE),
+                                 &hdr, sizeof(hdr));
+    if (ret)
+        return ret;
+
+    tlv = mt7927_mcu_batch_add_tlv(batch, UNI_BSS_INFO_BASIC, sizeof(*tlv));
+    if (IS_ERR(tlv))
+        return PTR_ERR(tlv);
+
+    /* Own MAC indices stay below MAX_INTERFACES, so each is its own BSSID */
+    tlv->active = enable;
+    tlv->omac_idx = mvif->idx;
+    tlv->hw_bss_idx = mvif->idx;
+    tlv->band_idx = mvif->band_idx;
+    tlv->wmm_idx = mvif->idx;
+    tlv->conn_type = cpu_to_le32(conn_type);
+    tlv->conn_state = 1;    /* Connected; port state follows STA_REC */
+    tlv->bmc_tx_wlan_idx = cpu_to_le16(mvif->bc_wcid);
+    tlv->sta_idx = cpu_to_le16(mvif->bc_wcid);
+
+    return 0;
+}
+
+/**
+ * mt7927_mcu_add_dev - Register or remove an interface with the firmware
+ * @dev: device structure
+ * @vif: interface; its own MAC index and group WTBL entry are assigned
+ * @enable: true on add_interface, false on remove_interface
+ *
+ * The own MAC address (DEV_INFO) and the BSS it serves (BSS_INFO) go out
+ * as one batch. The BSS is created after its device and torn down before it.
+ */
+int mt7927_mcu_add_dev(struct mt7927_dev *dev, struct ieee80211_vif *vif,
+                       bool enable)
+{
+    struct mt7927_mcu_batch batch;
+    int ret;
+
+    mt7927_mcu_batch_init(dev, &batch);
+
+    if (enable) {
+        ret = mt7927_mcu_dev_info(&batch, vif, true);
+        if (!ret)
+            ret = mt7927_mcu_bss_basic(&batch, vif, true);
+    } else {
+        ret = mt7927_mcu_bss_basic(&batch, vif, false);
+        if (!ret)
+            ret = mt7927_mcu_dev_info(&batch, vif, false);
+    }
+
+    if (ret) {
+        mt7927_mcu_batch_abort(&batch);
+        return ret;
+    }
+
+    return mt7927_mcu_batch_commit(&batch);
+}
+
+/* ============================================
+ * Station Setup
+ * ============================================ */
+
+static int mt7927_mcu_sta_begin(struct mt7927_mcu_batch *batch,
+                                struct ieee80211_vif *vif,
+                                struct ieee80211_sta *sta)
+{
+    struct mt7927_vif *mvif = (struct mt7927_vif *)vif->drv_priv;
+    struct mt7927_sta *msta = (struct mt7927_sta *)sta->drv_priv;
+    struct mt7927_sta_req_hdr hdr = {
+        .bss_idx = mvif->idx,
+        .wlan_idx_lo = msta->wcid & 0xff,
+        .wlan_idx_hi = msta->wcid >> 8,
+        .muar_idx = mvif->idx,
+        .is_tlv_append = 1,
+    };
+
+    return mt7927_mcu_batch_begin(batch,
+                                  MCU_WM_UNI_CMD(MCU_UNI_CMD_STA_REC_UPDATE),
+                                  &hdr, sizeof(hdr));
+}
+
+static int mt7927_mcu_sta_basic(struct mt7927_mcu_batch *batch,
+                                struct ieee80211_vif *vif,
+                                struct ieee80211_sta *sta, bool enable,
+                                u8 conn_state)
+{
+    struct mt7927_sta_rec_basic *basic;
+    u16 extra_info = EXTRA_INFO_VER;
+    u32 conn_type;
+
+    basic = mt7927_mcu_batch_add_tlv(batch, STA_REC_BASIC, sizeof(*basic));
+    if (IS_ERR(basic))
+        return PTR_ERR(basic);
+
+    /* The peer's role is the opposite of ours */
+    switch (vif->type) {
+    case NL80211_IFTYPE_AP:
+    case NL80211_IFTYPE_P2P_GO:
+    case NL80211_IFTYPE_MESH_POINT:
+        conn_type = CONNECTION_INFRA_STA;
+        basic->aid = cpu_to_le16(sta->aid);
+        break;
+    case NL80211_IFTYPE_ADHOC:
+        conn_type = CONNECTION_IBSS_ADHOC;
+        basic->aid = cpu_to_le16(sta->aid);
+        break;
+    default:
+        conn_type = CONNECTION_INFRA_AP;
+        basic->aid = cpu_to_le16(vif->cfg.aid);
+        break;
+    }
+
+    if (enable && conn_state != CONN_STATE_DISCONNECT)
+        extra_info |= EXTRA_INFO_NEW;
+
+    basic->conn_type = cpu_to_le32(conn_type);
+    basic->conn_state = enable ? conn_state : CONN_STATE_DISCONNECT;
+    basic->qos = sta->wme;
+    basic->extra_info = cpu_to_le16(extra_info);
+    memcpy(basic->peer_addr, sta->addr, ETH_ALEN);
+
+    return 0;
+}
+
+static int mt7927_mcu_sta_hdr_trans(struct mt7927_mcu_batch *batch,
+                                    struct ieee80211_vif *vif,
+                                    struct ieee80211_sta *sta)
+{
+    struct mt7927_sta *msta = (struct mt7927_sta *)sta->drv_priv;
+    struct mt7927_sta_rec_hdr_trans *hdr_trans;
+
+    hdr_trans = mt7927_mcu_batch_add_tlv(batch, STA_REC_HDR_TRANS,
+                                         sizeof(*hdr_trans));
+    if (IS_ERR(hdr_trans))
+        return PTR_ERR(hdr_trans);
+
+    /* Frames to an AP go to the DS, frames from an AP come from it */
+    if (vif->type == NL80211_IFTYPE_STATION)
+        hdr_trans->to_ds = true;
+    else
+        hdr_trans->from_ds = true;
+
+    hdr_trans->dis_rx_hdr_tran = !READ_ONCE(msta->decap);
+
+    return 0;
+}
+
+/**
+ * mt7927_mcu_sta_update - Program a station's WTBL entry
+ * @dev: device structure
+ * @vif: interface the station belongs to
+ * @sta: station; its wcid must be assigned
+ * @enable: false to tear the record down
+ * @conn_state: CONN_STATE_* once enabled
+ *
+ * The basic record and header translation go out as one batch, so the
+ * chip can build 802.11 headers for 802.3 frames (TX encap offload) as
+ * soon as the station is connected.
+ */
+int mt7927_mcu_sta_update(struct mt7927_dev *dev, struct ieee80211_vif *vif,
+                          struct ieee80211_sta *sta, bool enable,
+                          u8 conn_state)
+{
+    struct mt7927_mcu_batch batch;
+    int ret;
+
+    mt7927_mcu_batch_init(dev, &batch);
+
+    ret = mt7927_mcu_sta_begin(&batch, vif, sta);
+    if (!ret)
+        ret = mt7927_mcu_sta_basic(&batch, vif, sta, enable, conn_state);
+    if (!ret && enable)
+        ret = mt7927_mcu_sta_hdr_trans(&batch, vif, sta);
+
+    if (ret) {
+        mt7927_mcu_batch_abort(&batch);
+        return ret;
+    }
+
+    return mt7927_mcu_batch_commit(&batch);
+}
+
+/**
+ * mt7927_mcu_sta_update_hdr_trans - Reprogram only header translation
+ * @dev: device structure
+ * @vif: interface the station belongs to
+ * @sta: connected station
+ *
+ * For RX decap offload being switched on or off for a station.
+ */
+int mt7927_mcu_sta_update_hdr_trans(struct mt7927_dev *dev,
+                                    struct ieee80211_vif *vif,
+                                    struct ieee80211_sta *sta)
+{
+    struct mt7927_mcu_batch batch;
+    int ret;
+
+    mt7927_mcu_batch_init(dev, &batch);
+
+    ret = mt7927_mcu_sta_begin(&batch, vif, sta);
+    if (!ret)
+        ret = mt7927_mcu_sta_hdr_trans(&batch, vif, sta);
+
+    if (ret) {
+        mt7927_mcu_batch_abort(&batch);
+        return ret;
+    }
+
+    return mt7927_mcu_batch_commit(&batch);
+}
+
+/* ============================================
+ * Query Cache
+ * ============================================ */
+
+static void __mt7927_mcu_cache_flush(struct mt7927_dev *dev)
+{
+    struct mt7927_mcu_cache *cache = &dev->fw_cache;
+    struct mt7927_mcu_cache_entry *e, *tmp;
+
+    list_for_each_entry_safe(e, tmp, &cache->entries, list) {
+        list_del(&e->list);
+        dev_kfree_skb(e->resp);
+        kfree(e);
+    }
+}
+
+/**
+ * mt7927_mcu_cache_flush - Drop all cached query responses
+ */
+void mt7927_mcu_cache_flush(struct mt7927_dev *dev)
+{
+    mutex_lock(&dev->fw_cache.lock);
+    __mt7927_mcu_cache_flush(dev);
+    dev->fw_cache.valid = false;
+    mutex_unlock(&dev->fw_cache.lock);
+}
+
+/*
+ * mt7927_mcu_fw_ident - Identify the firmware that is about to run
+ *
+ * Taken from the image headers parsed during download and the live
+ * hardware revision, so a different firmware file or a different chip
+ * behind the same function invalidates the cache.
+ */
+static void mt7927_mcu_fw_ident(struct mt7927_dev *dev,
+                                struct mt7927_fw_ident *id)
+{
+    *id = dev->fw_ident;
+    id->hw_rev = mt7927_rr(dev, MT_HW_REV) & 0xff;
+}
+
+/*
+ * mt7927_mcu_cache_validate - Keep the cache only if the firmware matches
+ *
+ * Called once the firmware is running after probe, reset or resume.
+ */
+static void mt7927_mcu_cache_validate(struct mt7927_dev *dev)
+{
+    struct mt7927_mcu_cache *cache = &dev->fw_cache;
+    struct mt7927_fw_ident id;
+
+    mt7927_mcu_fw_ident(dev, &id);
+
+    mutex_lock(&cache->lock);
+
+    if (!cache->valid || memcmp(&cache->ident, &id, sizeof(id))) {
+        if (!list_empty(&cache->entries)) {
+            dev_info(dev->dev, "Firmware changed, dropping cached queries\n");
+            cache->flushes++;
+        }
+        __mt7927_mcu_cache_flush(dev);
+        cache->ident = id;
+        cache->valid = true;
+    }
+
+    mutex_unlock(&cache->lock);
+}
+
+/**
+ * mt7927_mcu_query_cached - Query the MCU, reusing an earlier answer
+ * @dev: device structure
+ * @cmd: query command
+ * @data: query payload; part of the cache key
+ * @len: payload length
+ * @ret_skb: response, owned by the caller as with mt7927_mcu_send_and_get_msg()
+ *
+ * Only for queries whose answer is fixed for a given firmware build and
+ * hardware revision (capabilities, versions, band configuration).
+ */
+int mt7927_mcu_query_cached(struct mt7927_dev *dev, int cmd,
+                            const void *data, int len,
+                            struct sk_buff **ret_skb)
+{
+    struct mt7927_mcu_cache *cache = &dev->fw_cache;
+    struct mt7927_mcu_cache_entry *e;
+    struct sk_buff *skb;
+    int ret;
+
+    mutex_lock(&cache->lock);
+
+    if (cache->valid) {
+        list_for_each_entry(e, &cache->entries, list) {
+            if (e->cmd != cmd || e->req_len != len ||
+                (len && memcmp(e->req, data, len)))
+                continue;
+
+            skb = skb_copy(e->resp, GFP_KERNEL);
+            if (!skb)
+                break;
+
+            cache->hits++;
+            mutex_unlock(&cache->lock);
+            *ret_skb = skb;
+            return 0;
+        }
+    }
+
+    cache->misses++;
+    mutex_unlock(&cache->lock);
+
+    ret = mt7927_mcu_send_and_get_msg(dev, cmd, data, len, true, &skb);
+    if (ret)
+        return ret;
+
+    e = kmalloc(struct_size(e, req, len), GFP_KERNEL);
+    if (e) {
+        e->resp = skb_copy(skb, GFP_KERNEL);
+        if (!e->resp) {
+            kfree(e);
+            e = NULL;
+        }
+    }
+
+    if (e) {
+        e->cmd = cmd;
+        e->req_len = len;
+        if (len)
+            memcpy(e->req, data, len);
+
+        mutex_lock(&cache->lock);
+        if (cache->valid) {
+            list_add_tail(&e->list, &cache->entries);
+            e = NULL;
+        }
+        mutex_unlock(&cache->lock);
+
+        if (e) {
+            dev_kfree_skb(e->resp);
+            kfree(e);
+        }
+    }
+
+    *ret_skb = skb;
+    return 0;
+}
+
+/* ============================================
+ * NIC Capability
+ * ============================================ */
+
+static void mt7927_mcu_parse_phy_cap(struct mt7927_dev *dev,
+                                     const struct mt7927_nic_cap_phy *phy)
+{
+    struct mt7927_nic_cap *cap = &dev->nic_cap;
+
+    cap->antenna_mask = GENMASK(clamp_t(u8, phy->nss, 1, 2) - 1, 0);
+    cap->has_2ghz = phy->hw_path & MT_NIC_CAP_PATH_2GHZ;
+    cap->has_5ghz = phy->hw_path & MT_NIC_CAP_PATH_5GHZ;
+
+    /* A report without any band is not trusted over the defaults */
+    cap->valid = cap->has_2ghz || cap->has_5ghz;
+}
+
+/**
+ * mt7927_mcu_get_nic_capability - Read the MAC address and radio limits
+ *
+ * Fixed for a firmware build and hardware revision, so it goes through
+ * the query cache and costs no MCU round trip after reset or resume.
+ * The MAC address is only taken while none is set.
+ */
+int mt7927_mcu_get_nic_capability(struct mt7927_dev *dev)
+{
+    struct {
+        u8 _rsv[4];
+
+        __le16 tag;
+        __le16 len;
+    } __packed req = {
+        .tag = cpu_to_le16(UNI_CHIP_CONFIG_NIC_CAPA),
+        .len = cpu_to_le16(sizeof(req) - 4),
+    };
+    struct mt7927_nic_cap_hdr *hdr;
+    struct mt7927_uni_tlv *tlv;
+    struct sk_buff *skb;
+    int i, len, ret;
+
+    ret = mt7927_mcu_query_cached(dev, MCU_UNI_CMD(MCU_UNI_CMD_CHIP_CONFIG),
+                                  &req, sizeof(req), &skb);
+    if (ret)
+        return ret;
+
+    if (skb->len < sizeof(struct mt7927_mcu_rxd) + sizeof(*hdr)) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    skb_pull(skb, sizeof(struct mt7927_mcu_rxd));
+    hdr = (struct mt7927_nic_cap_hdr *)skb->data;
+    skb_pull(skb, sizeof(*hdr));
+
+    for (i = 0; i < le16_to_cpu(hdr->n_element); i++) {
+        if (skb->len < sizeof(*tlv))
+            break;
+
+        tlv = (struct mt7927_uni_tlv *)skb->data;
+        len = le16_to_cpu(tlv->len);
+        if (len < sizeof(*tlv) || skb->len < len)
+            break;
+
+        switch (le16_to_cpu(tlv->tag)) {
+        case MT_NIC_CAP_MAC_ADDR:
+            if (len >= sizeof(*tlv) + ETH_ALEN &&
+                !is_valid_ether_addr(dev->macaddr) &&
+                is_valid_ether_addr(tlv->data))
+                ether_addr_copy(dev->macaddr, tlv->data);
+            break;
+        case MT_NIC_CAP_PHY:
+            if (len >= sizeof(*tlv) + sizeof(struct mt7927_nic_cap_phy))
+                mt7927_mcu_parse_phy_cap(dev, (void *)tlv->data);
+            break;
+        default:
+            break;
+        }
+
+        skb_pull(skb, len);
+    }
+
+out:
+    dev_kfree_skb(skb);
+    return ret;
+}
+
+/* ============================================
+ * Firmware Download Protocol
+ * ============================================ */
+
+/**
+ * mt7927_mcu_patch_sem_ctrl - Control patch semaphore
+ * @dev: device structure
+ * @get: true to acquire, false to release
+ */
+int mt7927_mcu_patch_sem_ctrl(struct mt7927_dev *dev, bool get)
+{
+    struct mt7927_patch_sem_req req = {
+        .op = get ? PATCH_SEM_GET : PATCH_SEM_RELEASE,
+    };
+    struct sk_buff *skb;
+    struct mt7927_mcu_rxd *rxd;
+    int ret;
+
+    ret = mt7927_mcu_send_and_get_msg(dev, MCU_CMD(MCU_CMD_PATCH_SEM_CONTROL),
+                                      &req, sizeof(req), true, &skb);
+    if (ret)
+        return ret;
+
+    /* Check response */
+    rxd = (struct mt7927_mcu_rxd *)skb->data;
+    skb_pull(skb, sizeof(*rxd) - 4);
+    ret = *skb->data;
+    dev_kfree_skb(skb);
+
+    if (get) {
+        if (ret == PATCH_SEM_READY) {
+            dev_dbg(dev->dev, "Patch semaphore acquired\n");
+            return 0;
+        } else if (ret == PATCH_SEM_NOT_READY) {
+            dev_dbg(dev->dev, "Patch already loaded\n");
+            return 1;  /* Patch already loaded */
+        } else {
+            dev_err(dev->dev, "Failed to acquire patch semaphore: %d\n", ret);
+            return -EIO;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * mt7927_mcu_start_patch - Signal patch loading complete
+ */
+int mt7927_mcu_start_patch(struct mt7927_dev *dev)
+{
+    u8 req[4] = {};
+
+    return mt7927_mcu_send_msg(dev, MCU_CMD(MCU_CMD_PATCH_FINISH_REQ),
+                               req, sizeof(req), true);
+}
+
+/**
+ * mt7927_mcu_start_firmware - Start firmware execution
+ * @dev: device structure
+ * @addr: firmware entry point address
+ */
+int mt7927_mcu_start_firmware(struct mt7927_dev *dev, u32 addr)
+{
+    struct mt7927_start_fw_req req = {
+        .override = cpu_to_le32(addr ? 1 : 0),
+        .addr = cpu_to_le32(addr),
+    };
+
+    return mt7927_mcu_send_msg(dev, MCU_CMD(MCU_CMD_START_FIRMWARE),
+                               &req, sizeof(req), true);
+}
+
+/* ============================================
+ * Zero-Copy Firmware Transfer
+ * ============================================ */
+
+/**
+ * mt7927_mcu_fw_map - DMA-map a firmware image in place
+ * @dev: device structure
+ * @map: mapping to fill
+ * @data: image (linear or vmalloc-backed, as request_firmware() returns it)
+ * @size: image size
+ *
+ * The image is mapped once per load; chunks are sent as slices of it so
+ * no firmware byte is copied and no large buffer is allocated.
+ */
+static int mt7927_mcu_fw_map(struct mt7927_dev *dev, struct mt7927_fw_map *map,
+                             const u8 *data, size_t size)
+{
+    unsigned int first = offset_in_page(data);
+    unsigned int i, n_pages;
+    struct page **pages;
+    int ret;
+
+    if (!is_vmalloc_addr(data)) {
+        ret = sg_alloc_table(&map->sgt, 1, GFP_KERNEL);
+        if (ret)
+            return ret;
+        sg_set_buf(map->sgt.sgl, data, size);
+    } else {
+        n_pages = DIV_ROUND_UP(first + size, PAGE_SIZE);
+        pages = kvmalloc_array(n_pages, sizeof(*pages), GFP_KERNEL);
+        if (!pages)
+            return -ENOMEM;
+
+        for (i = 0; i < n_pages; i++)
+            pages[i] = vmalloc_to_page(data - first + i * PAGE_SIZE);
+
+        ret = sg_alloc_table_from_pages(&map->sgt, pages, n_pages, first,
+                                        size, GFP_KERNEL);
+        kvfree(pages);
+        if (ret)
+            return ret;
+    }
+
+    ret = dma_map_sgtable(dev->dev, &map->sgt, DMA_TO_DEVICE, 0);
+    if (ret) {
+        sg_free_table(&map->sgt);
+        return ret;
+    }
+
+    return 0;
+}
+
+static void mt7927_mcu_fw_unmap(struct mt7927_dev *dev,
+                                struct mt7927_fw_map *map)
+{
+    dma_unmap_sgtable(dev->dev, &map->sgt, DMA_TO_DEVICE, 0);
+    sg_free_table(&map->sgt);
+}
+
+/*
+ * mt7927_mcu_fw_wait_idle - Wait until the FWDL ring has consumed everything
+ *
+ * Must complete before the image is unmapped.
+ */
+static int mt7927_mcu_fw_wait_idle(struct mt7927_dev *dev)
+{
+    struct mt7927_queue *q = dev->q_mcu[MT_MCUQ_FWDL];
+
+    if (!mt7927_tx_wait_idle(dev, q, HZ))
+        return 0;
+
+    dev_err(dev->dev, "FWDL ring did not drain (head %d tail %d)\n",
+            q->head, q->tail);
+    return -ETIMEDOUT;
+}
+
+/**
+ * mt7927_mcu_send_fw_segment - Send one pre-mapped firmware slice
+ * @dev: device structure
+ * @cmd: scatter command
+ * @addr: DMA address of the slice
+ * @len: slice length, at most MT7927_FW_SEG_MAX
+ *
+ * The TXD travels in a small skb in the first descriptor segment and the
+ * slice in the second. The slice must stay mapped until the FWDL ring
+ * drains.
+ */
+int mt7927_mcu_send_fw_segment(struct mt7927_dev *dev, int cmd,
+                               dma_addr_t addr, u32 len)
+{
+    struct mt7927_queue *q = dev->q_mcu[MT_MCUQ_FWDL];
+    struct mt7927_mcu_txd *txd;
+    struct sk_buff *skb;
+    int ret, retry;
+    u32 val;
+
+    skb = alloc_skb(sizeof(*txd), GFP_KERNEL);
+    if (!skb)
+        return -ENOMEM;
+
+    txd = skb_put_zero(skb, sizeof(*txd));
+
+    /* Lengths cover header and payload, as with a linear message */
+    val = FIELD_PREP(MT_TXD0_TX_BYTES, sizeof(*txd) + len) |
+          FIELD_PREP(MT_TXD0_PKT_FMT, MT_PKT_TYPE_FW);
+    txd->txd[0] = cpu_to_le32(val);
+
+    txd->len = cpu_to_le16(sizeof(*txd) + len);
+    txd->pq_id = cpu_to_le16(0x8000);
+    txd->cid = MCU_CMD_ID(cmd);
+    txd->pkt_type = MT_PKT_TYPE_FW;
+    /* Firmware data is never answered; keep it out of the sequence table */
+    txd->seq = 0;
+    txd->s2d_index = S2D_IDX_MCU;
+
+    MT7927_MCU_CB(skb)->cmd = cmd;
+    MT7927_MCU_CB(skb)->enqueue_ns = ktime_get_ns();
+
+    /* The FWDL ring is short; reap it and retry rather than fail */
+    for (retry = 0; ; retry++) {
+        ret = mt7927_tx_queue_skb_frag(dev, q, skb, addr, len);
+        if (ret != -ENOSPC || retry >= 100)
+            break;
+
+        mt7927_tx_complete(dev, q);
+        usleep_range(50, 100);
+    }
+
+    if (ret)
+        dev_kfree_skb(skb);
+
+    return ret;
+}
+
+/**
+ * mt7927_mcu_send_firmware - Send part of a mapped firmware image
+ * @dev: device structure
+ * @cmd: scatter command
+ * @map: image mapped with mt7927_mcu_fw_map()
+ * @offset: offset of the data in the image
+ * @len: data length
+ */
+int mt7927_mcu_send_firmware(struct mt7927_dev *dev, int cmd,
+                             const struct mt7927_fw_map *map,
+                             u32 offset, u32 len)
+{
+    struct scatterlist *sg;
+    u32 pos = 0, seg_len, cur;
+    dma_addr_t addr;
+    int i, ret;
+
+    for_each_sgtable_dma_sg(&map->sgt, sg, i) {
+        seg_len = sg_dma_len(sg);
+
+        if (pos + seg_len <= offset) {
+            pos += seg_len;
+            continue;
+        }
+
+        addr = sg_dma_address(sg) + (offset - pos);
+        seg_len -= offset - pos;
+
+        while (seg_len && len) {
+            cur = min3(seg_len, len, (u32)MT7927_FW_SEG_MAX);
+
+            ret = mt7927_mcu_send_fw_segment(dev, cmd, addr, cur);
+            if (ret)
+                return ret;
+
+            addr += cur;
+            offset += cur;
+            seg_len -= cur;
+            len -= cur;
+        }
+
+        if (!len)
+            return 0;
+
+        pos = offset;
+    }
+
+    return len ? -EINVAL : 0;
+}
+
+/* ============================================
+ * Firmware Sources
+ * ============================================ */
+
+static bool fw_stream;
+module_param(fw_stream, bool, 0644);
+MODULE_PARM_DESC(fw_stream, "Stream firmware in small windows instead of keeping whole images (default: false)");
+
+static bool fw_verify;
+module_param(fw_verify, bool, 0644);
+MODULE_PARM_DESC(fw_verify, "CRC32-check every firmware region while it downloads (default: false)");
+
+/*
+ * mt7927_fw_src_read - Copy @len bytes at @offset of the image into @buf
+ *
+ * Whole images are read from memory; streamed images with a bounded
+ * partial request. A short read means the image is truncated.
+ */
+static int mt7927_fw_src_read(struct mt7927_dev *dev, struct mt7927_fw_src *src,
+                              void *buf, size_t offset, size_t len)
+{
+    const struct firmware *fw;
+    int ret;
+
+    if (offset > src->size || len > src->size - offset)
+        return -EINVAL;
+
+    if (src->fw) {
+        memcpy(buf, src->fw->data + offset, len);
+        return 0;
+    }
+
+    ret = request_partial_firmware_into_buf(&fw, src->name, dev->dev,
+                                            buf, len, offset);
+    if (ret)
+        return ret;
+
+    ret = fw->size == len ? 0 : -EIO;
+    release_firmware(fw);
+
+    return ret;
+}
+
+/*
+ * mt7927_fw_stream_probe - Read up to @len bytes at @offset of a file
+ *
+ * Reads at or past the end of the file succeed with nothing copied, so
+ * @got of 0 is end of file; an error is a real read failure.
+ */
+static int mt7927_fw_stream_probe(struct mt7927_dev *dev,
+                                  struct mt7927_fw_src *src,
+                                  size_t offset, size_t len, size_t *got)
+{
+    const struct firmware *fw;
+    int ret;
+
+    ret = request_partial_firmware_into_buf(&fw, src->name, dev->dev,
+                                            src->buf[0], len, offset);
+    if (ret)
+        return ret;
+
+    *got = fw->size;
+    release_firmware(fw);
+
+    return 0;
+}
+
+/*
+ * mt7927_fw_stream_size - Find the size of an image without loading it
+ *
+ * The firmware loader does not report the file size for partial reads.
+ * The RAM image keeps its region table at the end, so the size is needed
+ * before validation. A file that fits the first window is sized by it;
+ * otherwise one-byte probes double the offset until it passes the end,
+ * then bisect, so a few dozen bytes are read rather than the whole file.
+ */
+static int mt7927_fw_stream_size(struct mt7927_dev *dev,
+                                 struct mt7927_fw_src *src)
+{
+    size_t lo, hi, mid, got;
+    int ret;
+
+    ret = mt7927_fw_stream_probe(dev, src, 0, MT7927_FW_STREAM_WINDOW, &got);
+    if (ret)
+        return ret;
+
+    if (got < MT7927_FW_STREAM_WINDOW) {
+        src->size = got;
+        return got ? 0 : -EINVAL;
+    }
+
+    /* The file holds at least @lo bytes and fewer than @hi */
+    lo = MT7927_FW_STREAM_WINDOW;
+    for (hi = lo * 2; ; hi *= 2) {
+        if (hi > INT_MAX)
+            return -EFBIG;
+
+        ret = mt7927_fw_stream_probe(dev, src, hi - 1, 1, &got);
+        if (ret)
+            return ret;
+        if (!got)
+            break;
+        lo = hi;
+    }
+
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        ret = mt7927_fw_stream_probe(dev, src, mid - 1, 1, &got);
+        if (ret)
+            return ret;
+        if (got)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    src->size = lo;
+    return 0;
+}
+
+static void mt7927_fw_src_release(struct mt7927_dev *dev,
+                                  struct mt7927_fw_src *src)
+{
+    int i;
+
+    for (i = 0; i < MT7927_FW_STREAM_BUFS; i++) {
+        if (!src->buf[i])
+            continue;
+        dma_free_coherent(dev->dev, MT7927_FW_STREAM_WINDOW, src->buf[i],
+                          src->dma[i]);
+        src->buf[i] = NULL;
+    }
+}
+
+/*
+ * mt7927_fw_src_init - Prepare an image for download
+ *
+ * With a retained image the data is sent zero-copy from its mapping;
+ * when streaming, a few coherent windows are refilled from the file.
+ */
+static int mt7927_fw_src_init(struct mt7927_dev *dev, struct mt7927_fw_src *src,
+                              const char *name, const struct firmware *fw,
+                              size_t *stream_size)
+{
+    int i, ret;
+
+    memset(src, 0, sizeof(*src));
+    src->name = name;
+
+    if (fw) {
+        src->fw = fw;
+        src->size = fw->size;
+        return 0;
+    }
+
+    for (i = 0; i < MT7927_FW_STREAM_BUFS; i++) {
+        src->buf[i] = dma_alloc_coherent(dev->dev, MT7927_FW_STREAM_WINDOW,
+                                         &src->dma[i], GFP_KERNEL);
+        if (!src->buf[i]) {
+            mt7927_fw_src_release(dev, src);
+            return -ENOMEM;
+        }
+    }
+
+    /* Remembered after the first scan so recovery does not rescan */
+    src->size = *stream_size;
+    if (!src->size) {
+        ret = mt7927_fw_stream_size(dev, src);
+        if (ret) {
+            dev_err(dev->dev, "Failed to read %s: %d\n", name, ret);
+            mt7927_fw_src_release(dev, src);
+            return ret;
+        }
+        *stream_size = src->size;
+    }
+
+    dev_info(dev->dev, "Streaming %s: %zu bytes in %u x %u byte windows\n",
+             name, src->size, MT7927_FW_STREAM_BUFS, MT7927_FW_STREAM_WINDOW);
+
+    return 0;
+}
+
+/*
+ * mt7927_fw_stream_send - Refill windows from the file and send them
+ *
+ * Windows are reused round-robin; before one is overwritten the FWDL
+ * ring is drained so the DMA engine is done reading it. The file read
+ * for a window overlaps the DMA of the ones before it.
+ */
+static int mt7927_fw_stream_send(struct mt7927_dev *dev,
+                                 struct mt7927_fw_src *src,
+                                 u32 offset, u32 len)
+{
+    u32 cur, seg, done;
+    int b, ret;
+
+    while (len) {
+        b = src->next;
+        if (src->used[b]) {
+            ret = mt7927_mcu_fw_wait_idle(dev);
+            if (ret)
+                return ret;
+            memset(src->used, 0, sizeof(src->used));
+        }
+
+        cur = min_t(u32, len, MT7927_FW_STREAM_WINDOW);
+        ret = mt7927_fw_src_read(dev, src, src->buf[b], offset, cur);
+        if (ret)
+            return ret;
+
+        for (done = 0; done < cur; done += seg) {
+            seg = min_t(u32, cur - done, MT7927_FW_SEG_MAX);
+            ret = mt7927_mcu_send_fw_segment(dev, MCU_CMD(MCU_CMD_FW_SCATTER),
+                                             src->dma[b] + done, seg);
+            if (ret)
+                return ret;
+        }
+
+        /* Hash the window while the ring fetches it */
+        if (src->verify)
+            src->crc = crc32_le(src->crc, src->buf[b], cur);
+
+        src->used[b] = true;
+        src->next = (b + 1) % MT7927_FW_STREAM_BUFS;
+        offset += cur;
+        len -= cur;
+    }
+
+    return 0;
+}
+
+/* ============================================
+ * Firmware Loading
+ * ============================================ */
+
+/*
+ * mt7927_fw_parse_patch - Validate the patch header and build its spans
+ *
+ * Runs before any data is sent; every region is checked against the
+ * image size. The build date goes to @id only on success.
+ */
+static int mt7927_fw_parse_patch(struct mt7927_dev *dev,
+                                 struct mt7927_fw_src *src,
+                                 struct mt7927_fw_span **spans, int *n_spans,
+                                 struct mt7927_fw_ident *id)
+{
+    struct mt7927_patch_hdr hdr;
+    struct mt7927_patch_sec *sec;
+    struct mt7927_fw_span *span;
+    u32 offset, len;
+    int i, n_region, ret;
+
+    ret = mt7927_fw_src_read(dev, src, &hdr, 0, sizeof(hdr));
+    if (ret) {
+        dev_err(dev->dev, "Invalid patch firmware\n");
+        return -EINVAL;
+    }
+
+    n_region = le32_to_cpu(hdr.sec_info.n_region);
+    if (n_region <= 0 || n_region > MT7927_FW_MAX_REGIONS) {
+        dev_err(dev->dev, "Invalid patch region count %d\n", n_region);
+        return -EINVAL;
+    }
+
+    sec = kcalloc(n_region, sizeof(*sec), GFP_KERNEL);
+    span = kcalloc(n_region, sizeof(*span), GFP_KERNEL);
+    if (!sec || !span) {
+        ret = -ENOMEM;
+        goto err;
+    }
+
+    ret = mt7927_fw_src_read(dev, src, sec, sizeof(hdr),
+                             n_region * sizeof(*sec));
+    if (ret) {
+        dev_err(dev->dev, "Patch region table truncated\n");
+        ret = -EINVAL;
+        goto err;
+    }
+
+    dev_info(dev->dev, "Loading patch firmware: %d regions\n", n_region);
+
+    offset = sizeof(hdr) + n_region * sizeof(*sec);
+    for (i = 0; i < n_region; i++) {
+        len = le32_to_cpu(sec[i].info.len);
+
+        if (offset > src->size || len > src->size - offset) {
+            dev_err(dev->dev, "Patch region %d exceeds firmware size\n", i);
+            ret = -EINVAL;
+            goto err;
+        }
+
+        span[i].addr = le32_to_cpu(sec[i].info.addr);
+        span[i].offset = offset;
+        span[i].len = len;
+
+        dev_dbg(dev->dev, "Patch region %d: addr=0x%08x len=%u\n",
+                i, span[i].addr, len);
+
+        offset += le32_to_cpu(sec[i].info.len);
     }
 
-    /* Select queue based on command */
-    if (cmd == MCU_CMD(MCU_CMD_FW_SCATTER))
-        q = dev->q_mcu[MT_MCUQ_FWDL];
-    else
-        q = dev->q_mcu[MT_MCUQ_WM];
+    memcpy(id->patch_build, hdr.build_date, sizeof(id->patch_build));
 
-    if (!q) {
-        dev_err(dev->dev, "MCU queue not initialized\n");
-        dev_kfree_skb(skb);
+    kfree(sec);
+    *spans = span;
+    *n_spans = n_region;
+    return 0;
+
+err:
+    kfree(sec);
+    kfree(span);
+    return ret;
+}
+
+/*
+ * mt7927_fw_parse_ram - Validate the RAM trailer/region table and build spans
+ *
+ * Version and build date go to @id only on success.
+ */
+static int mt7927_fw_parse_ram(struct mt7927_dev *dev,
+                               struct mt7927_fw_src *src,
+                               struct mt7927_fw_span **spans, int *n_spans,
+                               struct mt7927_fw_ident *id)
+{
+    struct mt7927_fw_trailer trailer;
+    struct mt7927_fw_region *region;
+    struct mt7927_fw_span *span;
+    size_t table, data_end;
+    u32 offset, len;
+    int i, n_region, ret;
+
+    if (src->size < sizeof(trailer) ||
+        mt7927_fw_src_read(dev, src, &trailer, src->size - sizeof(trailer),
+                           sizeof(trailer))) {
+        dev_err(dev->dev, "Invalid RAM firmware\n");
         return -EINVAL;
     }
 
-    /* Queue the message */
-    ret = mt7927_tx_queue_skb(dev, q, skb);
-    if (ret) {
-        dev_err(dev->dev, "Failed to queue MCU message: %d\n", ret);
-        dev_kfree_skb(skb);
-        return ret;
+    n_region = trailer.n_region;
+    table = n_region * sizeof(*region);
+    if (!n_region || src->size - sizeof(trailer) < table) {
+        dev_err(dev->dev, "Invalid RAM region count %d\n", n_region);
+        return -EINVAL;
     }
 
-    /* Wait for response if requested */
-    if (wait_resp) {
-        unsigned long timeout = dev->mcu.timeout;
-        struct sk_buff *resp_skb;
-        struct mt7927_mcu_rxd *rxd;
-
-        ret = wait_event_timeout(dev->mcu.wait,
-                                !skb_queue_empty(&dev->mcu.res_q),
-                                timeout);
-        if (ret <= 0) {
-            dev_err(dev->dev, "MCU command 0x%04x timeout (ret=%d)\n", cmd, ret);
-            return -ETIMEDOUT;
-        }
+    dev_info(dev->dev, "Loading RAM firmware: %d regions, version: %.10s\n",
+             n_region, trailer.fw_ver);
 
-        /* Get response from queue */
-        resp_skb = skb_dequeue(&dev->mcu.res_q);
-        if (!resp_skb) {
-            dev_err(dev->dev, "MCU response queue empty\n");
-            return -EIO;
-        }
+    region = kmalloc(table, GFP_KERNEL);
+    span = kcalloc(n_region, sizeof(*span), GFP_KERNEL);
+    if (!region || !span) {
+        ret = -ENOMEM;
+        goto err;
+    }
 
-        /* Validate response sequence */
-        rxd = (struct mt7927_mcu_rxd *)resp_skb->data;
-        if (rxd->seq != seq) {
-            dev_err(dev->dev, "MCU response seq mismatch: expected %d, got %d\n",
-                    seq, rxd->seq);
-            dev_kfree_skb(resp_skb);
-            return -EIO;
+    /* Region headers are before the trailer */
+    data_end = src->size - sizeof(trailer) - table;
+    ret = mt7927_fw_src_read(dev, src, region, data_end, table);
+    if (ret)
+        goto err;
+
+    offset = 0;
+    for (i = 0; i < n_region; i++) {
+        len = le32_to_cpu(region[i].len);
+
+        if (offset > data_end || len > data_end - offset) {
+            dev_err(dev->dev, "RAM region %d exceeds firmware size\n", i);
+            ret = -EINVAL;
+            goto err;
         }
 
-        /* Return response SKB if requested */
-        if (ret_skb)
-            *ret_skb = resp_skb;
-        else
-            dev_kfree_skb(resp_skb);
+        span[i].addr = le32_to_cpu(region[i].addr);
+        span[i].offset = offset;
+        span[i].len = len;
+
+        dev_dbg(dev->dev, "RAM region %d: addr=0x%08x len=%u name=%.32s\n",
+                i, span[i].addr, len, region[i].name);
+
+        offset += len;
     }
 
+    memcpy(id->ram_ver, trailer.fw_ver, sizeof(id->ram_ver));
+    memcpy(id->ram_build, trailer.build_date, sizeof(id->ram_build));
+
+    kfree(region);
+    *spans = span;
+    *n_spans = n_region;
     return 0;
+
+err:
+    kfree(region);
+    kfree(span);
+    return ret;
 }
 
 /* ============================================
- * Firmware Download Protocol
+ * Firmware Verification
  * ============================================ */
 
-/**
- * mt7927_mcu_patch_sem_ctrl - Control patch semaphore
- * @dev: device structure
- * @get: true to acquire, false to release
+void mt7927_fw_crc_free(struct mt7927_fw_crc *ref)
+{
+    kfree(ref->crc);
+    kfree(ref->pending);
+    memset(ref, 0, sizeof(*ref));
+}
+
+/*
+ * mt7927_fw_crc_commit - Adopt learned CRCs once the firmware has booted
+ *
+ * A download that completes can still carry an image the firmware
+ * rejects, so values learned from it become the reference only here.
  */
-int mt7927_mcu_patch_sem_ctrl(struct mt7927_dev *dev, bool get)
+static void mt7927_fw_crc_commit(struct mt7927_fw_crc *ref)
 {
-    struct mt7927_patch_sem_req req = {
-        .op = get ? PATCH_SEM_GET : PATCH_SEM_RELEASE,
-    };
-    struct sk_buff *skb;
-    struct mt7927_mcu_rxd *rxd;
-    int ret;
+    if (!ref->pending)
+        return;
 
-    ret = mt7927_mcu_send_and_get_msg(dev, MCU_CMD(MCU_CMD_PATCH_SEM_CONTROL),
-                                      &req, sizeof(req), true, &skb);
-    if (ret)
-        return ret;
+    ref->crc = ref->pending;
+    ref->pending = NULL;
+}
 
-    /* Check response */
-    rxd = (struct mt7927_mcu_rxd *)skb->data;
-    skb_pull(skb, sizeof(*rxd) - 4);
-    ret = *skb->data;
-    dev_kfree_skb(skb);
+static void mt7927_fw_crc_discard(struct mt7927_fw_crc *ref)
+{
+    kfree(ref->pending);
+    ref->pending = NULL;
+}
 
-    if (get) {
-        if (ret == PATCH_SEM_READY) {
-            dev_dbg(dev->dev, "Patch semaphore acquired\n");
-            return 0;
-        } else if (ret == PATCH_SEM_NOT_READY) {
-            dev_dbg(dev->dev, "Patch already loaded\n");
-            return 1;  /* Patch already loaded */
-        } else {
-            dev_err(dev->dev, "Failed to acquire patch semaphore: %d\n", ret);
-            return -EIO;
+/*
+ * mt7927_fw_crc_prepare - Pick the reference CRCs for this download
+ *
+ * A manifest always wins. Learned values are kept only for the same
+ * build and region layout; anything else is relearned.
+ */
+static void mt7927_fw_crc_prepare(struct mt7927_dev *dev,
+                                  struct mt7927_fw_src *src,
+                                  struct mt7927_fw_crc *ref, int n_spans)
+{
+    const struct firmware *m;
+    char name[128];
+    int i;
+
+    mt7927_fw_crc_discard(ref);
+
+    if (ref->crc && ref->n_region == n_spans &&
+        (ref->manifest || !memcmp(&ref->ident, &dev->fw_ident,
+                                  sizeof(ref->ident))))
+        return;
+
+    mt7927_fw_crc_free(ref);
+
+    snprintf(name, sizeof(name), "%s.crc32", src->name);
+    if (firmware_request_nowarn(&m, name, dev->dev))
+        return;
+
+    if (m->size == n_spans * sizeof(__le32)) {
+        ref->crc = kcalloc(n_spans, sizeof(u32), GFP_KERNEL);
+        if (ref->crc) {
+            for (i = 0; i < n_spans; i++)
+                ref->crc[i] = le32_to_cpu(((const __le32 *)m->data)[i]);
+            ref->n_region = n_spans;
+            ref->manifest = true;
         }
+    } else {
+        dev_warn(dev->dev, "Ignoring %s: %zu bytes for %d regions\n",
+                 name, m->size, n_spans);
     }
 
-    return ret;
+    release_firmware(m);
 }
 
-/**
- * mt7927_mcu_start_patch - Signal patch loading complete
+/*
+ * mt7927_fw_crc_check - Compare a finished region against its reference
+ *
+ * Called right after the region's last chunk is queued, so a corrupt
+ * image fails here instead of as an MCU start timeout.
  */
-int mt7927_mcu_start_patch(struct mt7927_dev *dev)
+static int mt7927_fw_crc_check(struct mt7927_dev *dev, struct mt7927_fw_crc *ref,
+                               u32 *learned, int region, u32 crc,
+                               const char *what)
 {
-    u8 req[4] = {};
+    learned[region] = crc;
 
-    return mt7927_mcu_send_msg(dev, MCU_CMD(MCU_CMD_PATCH_FINISH_REQ),
-                               req, sizeof(req), true);
+    if (!ref->crc || crc == ref->crc[region])
+        return 0;
+
+    dev_err(dev->dev, "%s region %d CRC mismatch: 0x%08x, expected 0x%08x (%s)\n",
+            what, region, crc, ref->crc[region],
+            ref->manifest ? "manifest" : "previous load");
+    return -EBADMSG;
 }
 
-/**
- * mt7927_mcu_start_firmware - Start firmware execution
- * @dev: device structure
- * @addr: firmware entry point address
+/* ============================================
+ * Transfer Planning
+ * ============================================ */
+
+/*
+ * mt7927_fw_plan_max_len - Largest scatter command the FWDL ring can carry
+ *
+ * One command's data should fit the ring in a single pass, leaving a
+ * slot for the command itself and one to tell full from empty.
  */
-int mt7927_mcu_start_firmware(struct mt7927_dev *dev, u32 addr)
+static u32 mt7927_fw_plan_max_len(struct mt7927_dev *dev)
 {
-    struct mt7927_start_fw_req req = {
-        .override = cpu_to_le32(addr ? 1 : 0),
-        .addr = cpu_to_le32(addr),
-    };
+    struct mt7927_queue *q = dev->q_mcu[MT_MCUQ_FWDL];
 
-    return mt7927_mcu_send_msg(dev, MCU_CMD(MCU_CMD_START_FIRMWARE),
-                               &req, sizeof(req), true);
+    return (q->ndesc - 2) * MT7927_FW_SEG_MAX;
 }
 
-/**
- * mt7927_mcu_send_firmware - Send firmware data via scatter command
- * @dev: device structure
- * @cmd: scatter command
- * @data: firmware data
- * @len: data length
- */
-int mt7927_mcu_send_firmware(struct mt7927_dev *dev, int cmd,
-                             const void *data, int len)
+static int mt7927_fw_plan_alloc(struct mt7927_dev *dev,
+                                const struct mt7927_fw_span *span, int n_spans,
+                                struct mt7927_fw_cmd **cmd)
 {
-    struct sk_buff *skb;
-    struct mt7927_mcu_txd *txd;
-    int ret, seq;
-    u32 val;
+    u32 max_len = mt7927_fw_plan_max_len(dev);
+    int n;
 
-    /* Allocate SKB for firmware chunk */
-    skb = alloc_skb(len + MT_MCU_HDR_SIZE + 32, GFP_KERNEL);
-    if (!skb)
+    n = mt7927_fw_plan(span, n_spans, max_len, NULL);
+    *cmd = kcalloc(max(n, 1), sizeof(**cmd), GFP_KERNEL);
+    if (!*cmd)
         return -ENOMEM;
 
-    skb_reserve(skb, MT_MCU_HDR_SIZE + 16);
-
-    /* Copy firmware data */
-    skb_put_data(skb, data, len);
-
-    /* Fill header */
-    txd = (struct mt7927_mcu_txd *)skb_push(skb, sizeof(*txd));
-    memset(txd, 0, sizeof(*txd));
+    return mt7927_fw_plan(span, n_spans, max_len, *cmd);
+}
 
-    seq = dev->mcu.seq++;
-    dev->mcu.seq &= 0xf;
+/*
+ * mt7927_fw_send_data - Send image bytes zero-copy or through windows
+ */
+static int mt7927_fw_send_data(struct mt7927_dev *dev, struct mt7927_fw_src *src,
+                               u32 offset, u32 len)
+{
+    int ret;
 
-    val = FIELD_PREP(MT_TXD0_TX_BYTES, skb->len) |
-          FIELD_PREP(MT_TXD0_PKT_FMT, MT_PKT_TYPE_FW);
-    txd->txd[0] = cpu_to_le32(val);
+    if (!src->fw)
+        return mt7927_fw_stream_send(dev, src, offset, len);
 
-    txd->len = cpu_to_le16(skb->len);
-    txd->pq_id = cpu_to_le16(0x8000);
-    txd->cid = MCU_CMD_ID(cmd);
-    txd->pkt_type = MT_PKT_TYPE_FW;
-    txd->seq = seq;
-    txd->s2d_index = S2D_IDX_MCU;
+    ret = mt7927_mcu_send_firmware(dev, MCU_CMD(MCU_CMD_FW_SCATTER),
+                                   &src->map, offset, len);
 
-    /* Send via FWDL queue */
-    ret = mt7927_tx_queue_skb(dev, dev->q_mcu[MT_MCUQ_FWDL], skb);
-    if (ret)
-        dev_kfree_skb(skb);
+    /* Hash the piece while the ring fetches it */
+    if (!ret && src->verify)
+        src->crc = crc32_le(src->crc, src->fw->data + offset, len);
 
     return ret;
 }
 
-/* ============================================
- * Firmware Loading
- * ============================================ */
-
-/**
- * mt7927_load_patch - Load ROM patch firmware
+/*
+ * mt7927_fw_download - Send validated spans to the MCU
+ *
+ * One scatter command per planned span, followed by its data; the data
+ * is sent region by region so each region's CRC can be checked as soon
+ * as its last byte is queued.
  */
-int mt7927_load_patch(struct mt7927_dev *dev)
+static int mt7927_fw_download(struct mt7927_dev *dev, struct mt7927_fw_src *src,
+                              const struct mt7927_fw_span *span, int n_spans,
+                              struct mt7927_fw_crc *ref, const char *what)
 {
-    const struct firmware *fw = dev->fw_patch;
-    const struct mt7927_patch_hdr *hdr;
-    const struct mt7927_patch_sec *sec;
-    const u8 *data;
-    int i, ret, n_region;
-    u32 addr, len, offset;
-
-    if (!fw || fw->size < sizeof(*hdr)) {
-        dev_err(dev->dev, "Invalid patch firmware\n");
-        return -EINVAL;
+    struct mt7927_fw_cmd *cmd;
+    u32 *learned = NULL;
+    u32 pos, end, piece, region_end;
+    int i, r, n_cmds, ret = 0;
+
+    n_cmds = mt7927_fw_plan_alloc(dev, span, n_spans, &cmd);
+    if (n_cmds < 0)
+        return n_cmds;
+
+    dev_dbg(dev->dev, "%s: %d regions in %d scatter commands\n",
+            what, n_spans, n_cmds);
+
+    if (fw_verify) {
+        mt7927_fw_crc_prepare(dev, src, ref, n_spans);
+        learned = kcalloc(n_spans, sizeof(u32), GFP_KERNEL);
+        src->verify = !!learned;
     }
 
-    hdr = (const struct mt7927_patch_hdr *)fw->data;
-    n_region = le32_to_cpu(hdr->sec_info.n_region);
-
-    dev_info(dev->dev, "Loading patch firmware: %d regions\n", n_region);
-
-    /* Parse and load each region */
-    offset = sizeof(*hdr) + n_region * sizeof(*sec);
-    sec = (const struct mt7927_patch_sec *)(fw->data + sizeof(*hdr));
-
-    for (i = 0; i < n_region; i++, sec++) {
-        addr = le32_to_cpu(sec->info.addr);
-        len = le32_to_cpu(sec->info.len);
+    if (src->fw) {
+        ret = mt7927_mcu_fw_map(dev, &src->map, src->fw->data, src->fw->size);
+        if (ret) {
+            dev_err(dev->dev, "Failed to map %s firmware: %d\n", what, ret);
+            kfree(learned);
+            kfree(cmd);
+            return ret;
+        }
+    }
 
-        if (offset + len > fw->size) {
-            dev_err(dev->dev, "Patch region %d exceeds firmware size\n", i);
-            return -EINVAL;
+    for (i = 0; i < n_cmds; i++) {
+        struct mt7927_fw_scatter scatter = {
+            .addr = cpu_to_le32(cmd[i].addr),
+            .len = cpu_to_le32(cmd[i].len),
+            .mode = cpu_to_le32(FW_MODE_DL),
+        };
+
+        ret = mt7927_mcu_send_msg(dev, MCU_CMD(MCU_CMD_FW_SCATTER),
+                                  &scatter, sizeof(scatter), false);
+        if (ret) {
+            dev_err(dev->dev, "Failed to send %s scatter: %d\n", what, ret);
+            goto out;
         }
 
-        data = fw->data + offset;
+        pos = cmd[i].offset;
+        end = cmd[i].offset + cmd[i].len;
 
-        dev_dbg(dev->dev, "Patch region %d: addr=0x%08x len=%u\n", i, addr, len);
+        for (r = cmd[i].region; pos < end; r++) {
+            region_end = span[r].offset + span[r].len;
+            if (!span[r].len || pos >= region_end)
+                continue;
 
-        /* Send firmware data in chunks */
-        while (len > 0) {
-            u32 chunk_len = min_t(u32, len, MT7927_FW_CHUNK_SIZE);
-            struct mt7927_fw_scatter scatter = {
-                .addr = cpu_to_le32(addr),
-                .len = cpu_to_le32(chunk_len),
-                .mode = cpu_to_le32(FW_MODE_DL),
-            };
+            if (pos == span[r].offset)
+                src->crc = ~0;
 
-            /* Send scatter header */
-            ret = mt7927_mcu_send_msg(dev, MCU_CMD(MCU_CMD_FW_SCATTER),
-                                      &scatter, sizeof(scatter), false);
+            piece = min(end, region_end) - pos;
+            ret = mt7927_fw_send_data(dev, src, pos, piece);
             if (ret) {
-                dev_err(dev->dev, "Failed to send patch scatter: %d\n", ret);
-                return ret;
+                dev_err(dev->dev, "Failed to send %s data (region %d): %d\n",
+                        what, r, ret);
+                goto out;
             }
+            pos += piece;
 
-            /* Send firmware chunk */
-            ret = mt7927_mcu_send_firmware(dev, MCU_CMD(MCU_CMD_FW_SCATTER),
-                                           data, chunk_len);
-            if (ret) {
-                dev_err(dev->dev, "Failed to send patch data: %d\n", ret);
-                return ret;
+            if (src->verify && pos == region_end) {
+                ret = mt7927_fw_crc_check(dev, ref, learned, r, ~src->crc,
+                                          what);
+                if (ret)
+                    goto out;
             }
-
-            data += chunk_len;
-            addr += chunk_len;
-            len -= chunk_len;
-
-            /* Small delay between chunks */
-            usleep_range(100, 200);
         }
 
-        offset += le32_to_cpu(sec->info.len);
+        /* Small delay between commands */
+        usleep_range(100, 200);
     }
 
-    return 0;
+    /* Becomes the reference if the firmware boots from this download */
+    if (src->verify && !ref->crc) {
+        ref->pending = learned;
+        ref->n_region = n_spans;
+        ref->ident = dev->fw_ident;
+        learned = NULL;
+    }
+
+out:
+    kfree(learned);
+    kfree(cmd);
+
+    /* Buffers stay live until the ring has fetched every slice */
+    if (mt7927_mcu_fw_wait_idle(dev) && !ret)
+        ret = -ETIMEDOUT;
+
+    if (src->fw)
+        mt7927_mcu_fw_unmap(dev, &src->map);
+
+    return ret;
 }
 
-/**
- * mt7927_load_ram - Load RAM code firmware
+/*
+ * mt7927_fw_plan_show_one - Print the schedule for one image
+ *
+ * Parses into a scratch ident so the identity of the running firmware
+ * is untouched.
  */
-int mt7927_load_ram(struct mt7927_dev *dev)
+static void mt7927_fw_plan_show_one(struct mt7927_dev *dev, struct seq_file *s,
+                                    const char *name,
+                                    const struct firmware *fw,
+                                    size_t *stream_size, bool patch)
 {
-    const struct firmware *fw = dev->fw_ram;
-    const struct mt7927_fw_trailer *trailer;
-    const struct mt7927_fw_region *region;
-    const u8 *data;
-    int i, ret, n_region;
-    u32 offset;
+    struct mt7927_fw_ident id = {};
+    struct mt7927_fw_span *spans;
+    struct mt7927_fw_cmd *cmd;
+    struct mt7927_fw_src src;
+    int i, n_spans, n_cmds, ret;
+    u32 segs = 0;
 
-    if (!fw || fw->size < sizeof(*trailer)) {
-        dev_err(dev->dev, "Invalid RAM firmware\n");
-        return -EINVAL;
+    seq_printf(s, "%s\n", name);
+
+    ret = mt7927_fw_src_init(dev, &src, name, fw, stream_size);
+    if (ret) {
+        seq_printf(s, "  error %d\n", ret);
+        return;
     }
 
-    /* Trailer is at the end of firmware */
-    trailer = (const struct mt7927_fw_trailer *)(fw->data + fw->size - sizeof(*trailer));
-    n_region = trailer->n_region;
+    ret = patch ? mt7927_fw_parse_patch(dev, &src, &spans, &n_spans, &id) :
+                  mt7927_fw_parse_ram(dev, &src, &spans, &n_spans, &id);
+    if (ret)
+        goto out;
 
-    dev_info(dev->dev, "Loading RAM firmware: %d regions, version: %.10s\n",
-             n_region, trailer->fw_ver);
+    n_cmds = mt7927_fw_plan_alloc(dev, spans, n_spans, &cmd);
+    if (n_cmds < 0) {
+        ret = n_cmds;
+        goto out_spans;
+    }
 
-    /* Region headers are before the trailer */
-    offset = fw->size - sizeof(*trailer) - n_region * sizeof(*region);
-    region = (const struct mt7927_fw_region *)(fw->data + offset);
+    for (i = 0; i < n_cmds; i++) {
+        segs += DIV_ROUND_UP(cmd[i].len, MT7927_FW_SEG_MAX);
+        seq_printf(s, "  cmd %d: addr 0x%08x offset 0x%06x len %u regions %u-%u\n",
+                   i, cmd[i].addr, cmd[i].offset, cmd[i].len, cmd[i].region,
+                   cmd[i].region + cmd[i].n_region - 1);
+    }
 
-    /* Process each region */
-    offset = 0;
-    for (i = 0; i < n_region; i++, region++) {
-        u32 addr = le32_to_cpu(region->addr);
-        u32 len = le32_to_cpu(region->len);
+    seq_printf(s, "  %d regions, %d scatter commands, %u data descriptors (max %u bytes per command)\n",
+               n_spans, n_cmds, segs, mt7927_fw_plan_max_len(dev));
 
-        if (offset + len > fw->size - sizeof(*trailer) - n_region * sizeof(*region)) {
-            dev_err(dev->dev, "RAM region %d exceeds firmware size\n", i);
-            return -EINVAL;
-        }
+    kfree(cmd);
+out_spans:
+    kfree(spans);
+out:
+    if (ret)
+        seq_printf(s, "  error %d\n", ret);
+    mt7927_fw_src_release(dev, &src);
+}
 
-        data = fw->data + offset;
+/**
+ * mt7927_fw_plan_show - Dry run: print the download schedule, send nothing
+ *
+ * dev->mutex keeps recovery and resume, which reload and on failure
+ * release the images, from running underneath.
+ */
+int mt7927_fw_plan_show(struct mt7927_dev *dev, struct seq_file *s)
+{
+    mutex_lock(&dev->mutex);
+    mt7927_fw_plan_show_one(dev, s, MT7927_ROM_PATCH, dev->fw_patch,
+                            &dev->fw_patch_size, true);
+    mt7927_fw_plan_show_one(dev, s, MT7927_FIRMWARE_WM, dev->fw_ram,
+                            &dev->fw_ram_size, false);
+    mutex_unlock(&dev->mutex);
 
-        dev_dbg(dev->dev, "RAM region %d: addr=0x%08x len=%u name=%.32s\n",
-                i, addr, len, region->name);
-
-        /* Send firmware data in chunks */
-        while (len > 0) {
-            u32 chunk_len = min_t(u32, len, MT7927_FW_CHUNK_SIZE);
-            struct mt7927_fw_scatter scatter = {
-                .addr = cpu_to_le32(addr),
-                .len = cpu_to_le32(chunk_len),
-                .mode = cpu_to_le32(FW_MODE_DL),
-            };
-
-            /* Send scatter header */
-            ret = mt7927_mcu_send_msg(dev, MCU_CMD(MCU_CMD_FW_SCATTER),
-                                      &scatter, sizeof(scatter), false);
-            if (ret) {
-                dev_err(dev->dev, "Failed to send RAM scatter: %d\n", ret);
-                return ret;
-            }
+    return 0;
+}
 
-            /* Send firmware chunk */
-            ret = mt7927_mcu_send_firmware(dev, MCU_CMD(MCU_CMD_FW_SCATTER),
-                                           data, chunk_len);
-            if (ret) {
-                dev_err(dev->dev, "Failed to send RAM data: %d\n", ret);
-                return ret;
-            }
+/**
+ * mt7927_load_patch - Load ROM patch firmware
+ */
+int mt7927_load_patch(struct mt7927_dev *dev)
+{
+    struct mt7927_fw_span *spans;
+    struct mt7927_fw_src src;
+    int ret, n_spans;
+
+    ret = mt7927_fw_src_init(dev, &src, MT7927_ROM_PATCH, dev->fw_patch,
+                             &dev->fw_patch_size);
+    if (ret)
+        return ret;
 
-            data += chunk_len;
-            addr += chunk_len;
-            len -= chunk_len;
+    ret = mt7927_fw_parse_patch(dev, &src, &spans, &n_spans,
+                                &dev->fw_ident);
+    if (ret)
+        goto out;
 
-            usleep_range(100, 200);
-        }
+    ret = mt7927_fw_download(dev, &src, spans, n_spans, &dev->fw_patch_crc,
+                             "patch");
+    kfree(spans);
 
-        offset += le32_to_cpu(region->len);
-    }
+out:
+    mt7927_fw_src_release(dev, &src);
+    return ret;
+}
 
-    return 0;
+/**
+ * mt7927_load_ram - Load RAM code firmware
+ */
+int mt7927_load_ram(struct mt7927_dev *dev)
+{
+    struct mt7927_fw_span *spans;
+    struct mt7927_fw_src src;
+    int ret, n_spans;
+
+    ret = mt7927_fw_src_init(dev, &src, MT7927_FIRMWARE_WM, dev->fw_ram,
+                             &dev->fw_ram_size);
+    if (ret)
+        return ret;
+
+    ret = mt7927_fw_parse_ram(dev, &src, &spans, &n_spans, &dev->fw_ident);
+    if (ret)
+        goto out;
+
+    ret = mt7927_fw_download(dev, &src, spans, n_spans, &dev->fw_ram_crc,
+                             "RAM");
+    kfree(spans);
+
+out:
+    mt7927_fw_src_release(dev, &src);
+    return ret;
 }
 
 /**
@@ -476,20 +2504,27 @@ int mt7927_load_firmware(struct mt7927_dev *dev)
 
     dev_info(dev->dev, "Loading firmware...\n");
 
-    /* Request firmware files */
-    ret = request_firmware(&dev->fw_patch, MT7927_ROM_PATCH, dev->dev);
-    if (ret) {
-        dev_err(dev->dev, "Failed to load ROM patch: %s\n", MT7927_ROM_PATCH);
-        return ret;
+    /*
+     * Request firmware files (already held when re-initializing after
+     * reset). When streaming, images are read window by window instead.
+     */
+    if (!fw_stream && !dev->fw_patch) {
+        ret = request_firmware(&dev->fw_patch, MT7927_ROM_PATCH, dev->dev);
+        if (ret) {
+            dev_err(dev->dev, "Failed to load ROM patch: %s\n", MT7927_ROM_PATCH);
+            return ret;
+        }
+        dev_info(dev->dev, "Loaded ROM patch: %zu bytes\n", dev->fw_patch->size);
     }
-    dev_info(dev->dev, "Loaded ROM patch: %zu bytes\n", dev->fw_patch->size);
 
-    ret = request_firmware(&dev->fw_ram, MT7927_FIRMWARE_WM, dev->dev);
-    if (ret) {
-        dev_err(dev->dev, "Failed to load RAM firmware: %s\n", MT7927_FIRMWARE_WM);
-        goto err_release_patch;
+    if (!fw_stream && !dev->fw_ram) {
+        ret = request_firmware(&dev->fw_ram, MT7927_FIRMWARE_WM, dev->dev);
+        if (ret) {
+            dev_err(dev->dev, "Failed to load RAM firmware: %s\n", MT7927_FIRMWARE_WM);
+            goto err_release_patch;
+        }
+        dev_info(dev->dev, "Loaded RAM firmware: %zu bytes\n", dev->fw_ram->size);
     }
-    dev_info(dev->dev, "Loaded RAM firmware: %zu bytes\n", dev->fw_ram->size);
 
     /* Step 1: Acquire patch semaphore */
     ret = mt7927_mcu_patch_sem_ctrl(dev, true);
@@ -540,6 +2575,9 @@ load_ram:
         goto err_release_ram;
     }
 
+    mt7927_fw_crc_commit(&dev->fw_patch_crc);
+    mt7927_fw_crc_commit(&dev->fw_ram_crc);
+
     /* Wait for firmware to become ready */
     msleep(100);
 
@@ -551,6 +2589,8 @@ load_ram:
 err_sem_release:
     mt7927_mcu_patch_sem_ctrl(dev, false);
 err_release_ram:
+    mt7927_fw_crc_discard(&dev->fw_patch_crc);
+    mt7927_fw_crc_discard(&dev->fw_ram_crc);
     release_firmware(dev->fw_ram);
     dev->fw_ram = NULL;
 err_release_patch:
@@ -587,7 +2627,10 @@ int mt7927_mcu_init(struct mt7927_dev *dev)
         /* Continue anyway */
     }
 
-    /* Disable L0S power saving for stable DMA operation */
+    /*
+     * Disable L0S power saving for stable DMA operation. Once the MCU is
+     * running the link power policy (mt7927_pm.c) takes over.
+     */
     val = mt7927_rr(dev, MT_PCIE_MAC_PM);
     dev_info(dev->dev, "PCIE_MAC_PM before: 0x%08x\n", val);
     mt7927_set(dev, MT_PCIE_MAC_PM, MT_PCIE_MAC_PM_L0S_DIS);
@@ -611,9 +2654,16 @@ int mt7927_mcu_init(struct mt7927_dev *dev)
     if (ret)
         return ret;
 
+    mt7927_mcu_cache_validate(dev);
+
     dev->mcu.state = MT7927_MCU_STATE_RUNNING;
     set_bit(MT7927_STATE_MCU_RUNNING, &dev->state);
 
+    /* Without it the defaults (random address, two chains) are used */
+    ret = mt7927_mcu_get_nic_capability(dev);
+    if (ret)
+        dev_warn(dev->dev, "NIC capability query failed: %d\n", ret);
+
     dev_info(dev->dev, "MCU initialization complete\n");
     return 0;
 }
@@ -623,10 +2673,36 @@ int mt7927_mcu_init(struct mt7927_dev *dev)
  */
 void mt7927_mcu_exit(struct mt7927_dev *dev)
 {
+    unsigned long flags;
+    int i;
+
     dev_info(dev->dev, "Shutting down MCU...\n");
 
-    /* Purge response queue */
-    skb_queue_purge(&dev->mcu.res_q);
+    /* Events from the previous firmware instance are obsolete */
+    if (dev->mcu.event_wq) {
+        cancel_work_sync(&dev->mcu.event_work);
+        skb_queue_purge(&dev->mcu.event_q);
+    }
+
+    /* Abort waiters and drop responses nobody will collect */
+    spin_lock_irqsave(&dev->mcu.lock, flags);
+    for (i = 0; i < MT7927_MCU_SEQ_NUM; i++) {
+        struct mt7927_mcu_req *req = &dev->mcu.req[i];
+
+        if (req->state == MT7927_MCU_REQ_WAITING) {
+            dev_kfree_skb_any(req->skb);
+            req->skb = NULL;
+            complete(&req->done);
+            continue;
+        }
+
+        /* Firmware restarts after this; nothing late can arrive */
+        dev_kfree_skb_any(req->skb);
+        req->skb = NULL;
+        req->state = MT7927_MCU_REQ_FREE;
+    }
+    spin_unlock_irqrestore(&dev->mcu.lock, flags);
+    wake_up(&dev->mcu.wait);
 
     /* Clear MCU running state */
     clear_bit(MT7927_STATE_MCU_RUNNING, &dev->state);
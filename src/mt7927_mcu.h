@@ -11,6 +11,11 @@
 #define __MT7927_MCU_H
 
 #include <linux/types.h>
+#include <linux/skbuff.h>
+#include <linux/scatterlist.h>
+#include <linux/sizes.h>
+
+#include "mt7927_fw_plan.h"
 
 /* ============================================
  * MCU Command Structure
@@ -40,6 +45,17 @@
 #define MCU_UNI_CMD_BAND_CONFIG     0x08
 #define MCU_UNI_CMD_REPT_MUAR       0x09
 #define MCU_UNI_CMD_REG_ACCESS      0x0d
+#define MCU_UNI_CMD_CHIP_CONFIG     0x0e
+
+/* UNI message payload: fixed per-command header, then TLVs */
+struct mt7927_uni_tlv {
+    __le16 tag;
+    __le16 len;             /* Including this header */
+    u8 data[];
+} __packed;
+
+/* Largest UNI payload that fits one MCU message */
+#define MT7927_UNI_MSG_MAX_PAYLOAD  (MT_MCU_MSG_MAX_SIZE - MT_MCU_HDR_SIZE)
 
 /* MCU event IDs */
 #define MCU_EVENT_FW_READY          0x01
@@ -55,7 +71,7 @@
 #define MCU_CMD_FIELD_WM            BIT(19)
 
 /* Source to destination indices */
-#define S2D_IDX_MCU                 0
+#define S2D_IDX_MCU                 0       /* Host to WM */
 #define D2S_IDX_MCU                 0
 
 /* ============================================
@@ -81,15 +97,39 @@ struct mt7927_mcu_txd {
     u32 rsv[5];
 } __packed __aligned(4);
 
+/* Header of UNI commands (MCU_CMD_FIELD_UNI): 16-bit CID and an option byte */
+struct mt7927_mcu_uni_txd {
+    __le32 txd[8];          /* TX descriptor words */
+
+    __le16 len;             /* Message length, without txd[] */
+    __le16 cid;             /* UNI command ID */
+
+    u8 rsv;
+    u8 pkt_type;            /* MCU_PKT_ID */
+    u8 frag_n;
+    u8 seq;                 /* Sequence number */
+
+    __le16 checksum;        /* 0: none */
+    u8 s2d_index;           /* Source to destination index */
+    u8 option;              /* MCU_UNI_OPT_* */
+
+    u8 rsv1[4];
+} __packed __aligned(4);
+
+#define MCU_PKT_ID              0xa0
+
+/* UNI command options */
+#define MCU_UNI_OPT_ACK         BIT(0)  /* Answer with a command result event */
+#define MCU_UNI_OPT_UNI         BIT(1)
+#define MCU_UNI_OPT_SET         BIT(2)  /* 0: query */
+
 /* TX descriptor bits */
 #define MT_TXD0_Q_IDX           GENMASK(31, 25)
 #define MT_TXD0_PKT_FMT         GENMASK(24, 23)
 #define MT_TXD0_ETH_TYPE_OFFSET GENMASK(22, 16)
 #define MT_TXD0_TX_BYTES        GENMASK(15, 0)
 
-#define MT_TXD1_OWN_MAC         GENMASK(31, 26)
-#define MT_TXD1_HDR_FORMAT      GENMASK(7, 5)
-#define MT_TXD1_TID             GENMASK(4, 0)
+/* Words 1-7 of data-frame TXDs are in mt7927_mac.h */
 
 /* Packet type values */
 #define MT_PKT_TYPE_TXD         0
@@ -130,6 +170,149 @@ struct mt7927_mcu_uni_event {
     __le32 status;          /* 0: success, others: fail */
 } __packed;
 
+/* ============================================
+ * NIC Capability (CHIP_CONFIG)
+ * ============================================ */
+
+/* CHIP_CONFIG tags */
+#define UNI_CHIP_CONFIG_NIC_CAPA    0x03
+
+/* NIC capability elements */
+#define MT_NIC_CAP_MAC_ADDR         0x07
+#define MT_NIC_CAP_PHY              0x08
+
+/* Response: header, then n_element TLVs */
+struct mt7927_nic_cap_hdr {
+    __le16 n_element;
+    u8 rsv[2];
+} __packed;
+
+struct mt7927_nic_cap_phy {
+    u8 ht;
+    u8 vht;
+    u8 _5g;
+    u8 max_bw;
+    u8 nss;
+    u8 dbdc;
+    u8 tx_ldpc;
+    u8 rx_ldpc;
+    u8 tx_stbc;
+    u8 rx_stbc;
+    u8 hw_path;             /* MT_NIC_CAP_PATH_* */
+    u8 he;
+    u8 eht;
+} __packed;
+
+#define MT_NIC_CAP_PATH_2GHZ        BIT(0)
+#define MT_NIC_CAP_PATH_5GHZ        BIT(1)
+
+/* ============================================
+ * Interface Setup (DEV_INFO / BSS_INFO)
+ * ============================================ */
+
+/* DEV_INFO_UPDATE tags */
+#define UNI_DEV_INFO_ACTIVE         0
+
+/* BSS_INFO_UPDATE tags */
+#define UNI_BSS_INFO_BASIC          0
+
+/* BSS connection types */
+#define STA_TYPE_STA                BIT(0)
+#define STA_TYPE_AP                 BIT(1)
+#define STA_TYPE_ADHOC              BIT(2)
+#define NETWORK_INFRA               BIT(16)
+#define NETWORK_P2P                 BIT(17)
+#define NETWORK_IBSS                BIT(18)
+
+#define CONNECTION_INFRA_STA        (STA_TYPE_STA | NETWORK_INFRA)
+#define CONNECTION_INFRA_AP         (STA_TYPE_AP | NETWORK_INFRA)
+#define CONNECTION_P2P_GO           (STA_TYPE_AP | NETWORK_P2P)
+#define CONNECTION_IBSS_ADHOC       (STA_TYPE_ADHOC | NETWORK_IBSS)
+
+/* DEV_INFO_UPDATE fixed header */
+struct mt7927_dev_info_hdr {
+    u8 omac_idx;
+    u8 band_idx;
+    __le16 pad;
+} __packed;
+
+struct mt7927_dev_info_active_tlv {
+    __le16 tag;
+    __le16 len;
+    u8 active;
+    u8 link_idx;
+    u8 omac_addr[ETH_ALEN];
+} __packed;
+
+/* BSS_INFO_UPDATE fixed header */
+struct mt7927_bss_info_hdr {
+    u8 bss_idx;
+    u8 pad[3];
+} __packed;
+
+struct mt7927_bss_basic_tlv {
+    __le16 tag;
+    __le16 len;
+    u8 active;
+    u8 omac_idx;
+    u8 hw_bss_idx;
+    u8 band_idx;
+    __le32 conn_type;
+    u8 conn_state;
+    u8 wmm_idx;
+    u8 bssid[ETH_ALEN];
+    __le16 bmc_tx_wlan_idx;
+    __le16 bcn_interval;
+    u8 dtim_period;
+    u8 phymode;
+    __le16 sta_idx;
+    __le16 nonht_basic_phy;
+    u8 phymode_ext;
+    u8 link_idx;
+} __packed;
+
+/* ============================================
+ * Station Setup (STA_REC)
+ * ============================================ */
+
+/* STA_REC_UPDATE tags */
+#define STA_REC_BASIC               0x00
+#define STA_REC_HDR_TRANS           0x2b
+
+/* STA_REC_UPDATE fixed header */
+struct mt7927_sta_req_hdr {
+    u8 bss_idx;
+    u8 wlan_idx_lo;
+    __le16 tlv_num;
+    u8 is_tlv_append;
+    u8 muar_idx;
+    u8 wlan_idx_hi;
+    u8 rsv;
+} __packed;
+
+struct mt7927_sta_rec_basic {
+    __le16 tag;
+    __le16 len;
+    __le32 conn_type;
+    u8 conn_state;
+    u8 qos;
+    __le16 aid;
+    u8 peer_addr[ETH_ALEN];
+#define EXTRA_INFO_VER              BIT(0)
+#define EXTRA_INFO_NEW              BIT(1)
+    __le16 extra_info;
+} __packed;
+
+/* 802.3 <-> 802.11 header translation for one station's WTBL entry */
+struct mt7927_sta_rec_hdr_trans {
+    __le16 tag;
+    __le16 len;
+    u8 from_ds;
+    u8 to_ds;
+    u8 dis_rx_hdr_tran;
+    u8 rsv;
+} __packed;
+
 /* ============================================
  * Firmware Download Structures
  * ============================================ */
@@ -206,6 +389,38 @@ struct mt7927_fw_scatter {
     u8 rsv[4];
 } __packed;
 
+/* Firmware image mapped for zero-copy download */
+struct mt7927_fw_map {
+    struct sg_table sgt;
+};
+
+/* Sanity limit on regions in a patch image */
+#define MT7927_FW_MAX_REGIONS   32
+
+/* Streaming load: reusable DMA windows refilled from the file */
+#define MT7927_FW_STREAM_BUFS   4
+#define MT7927_FW_STREAM_WINDOW SZ_16K
+
+/* Where download data comes from: a retained image or the file itself */
+struct mt7927_fw_src {
+    const char *name;
+    size_t size;
+
+    /* Retained image, sent zero-copy */
+    const struct firmware *fw;
+    struct mt7927_fw_map map;
+
+    /* Streaming windows */
+    void *buf[MT7927_FW_STREAM_BUFS];
+    dma_addr_t dma[MT7927_FW_STREAM_BUFS];
+    bool used[MT7927_FW_STREAM_BUFS];   /* Still possibly read by DMA */
+    int next;
+
+    /* Running CRC32 of the region being sent, when verifying */
+    bool verify;
+    u32 crc;
+};
+
 /* Firmware download modes */
 #define FW_MODE_DL              0
 #define FW_MODE_START           1
@@ -254,19 +469,59 @@ struct mt7927_restart_dl_req {
 #define MCU_CMD_ID(cmd)         FIELD_GET(MCU_CMD_FIELD_ID, cmd)
 #define MCU_CMD_EXT_ID(cmd)     FIELD_GET(MCU_CMD_FIELD_EXT_ID, cmd)
 
+/* ============================================
+ * UNI Command Batching
+ * ============================================ */
+
+/*
+ * Accumulates TLVs for one or more UNI commands. Each message is sized for
+ * MT7927_UNI_MSG_MAX_PAYLOAD up front and filled in place; when a TLV does
+ * not fit, the message is closed and a continuation carrying the same
+ * fixed header is started. Nothing reaches the MCU until commit.
+ */
+
+/* Batch messages on the WM ring at once, each holding a sequence number */
+#define MT7927_MCU_BATCH_INFLIGHT   4
+
+struct mt7927_mcu_batch {
+    struct mt7927_dev *dev;
+    struct sk_buff_head msgs;       /* Closed messages, in commit order */
+    struct sk_buff *skb;            /* Message being filled */
+    int cmd;                        /* Command of the message being filled */
+    int hdr_len;                    /* Fixed header repeated on continuation */
+};
+
 /* ============================================
  * Function Declarations
  * ============================================ */
 
 /* MCU message operations */
 int mt7927_mcu_fill_message(struct mt7927_dev *dev, struct sk_buff *skb,
-                            int cmd, int *seq);
+                            int cmd, int seq);
+struct sk_buff *mt7927_mcu_msg_alloc(struct mt7927_dev *dev,
+                                     const void *data, int len);
+void *mt7927_mcu_add_tlv(struct sk_buff *skb, u16 tag, u16 len);
+int mt7927_mcu_skb_send_msg(struct mt7927_dev *dev, struct sk_buff *skb,
+                            int cmd, bool wait_resp);
+
+/* UNI command batching */
+void mt7927_mcu_batch_init(struct mt7927_dev *dev,
+                           struct mt7927_mcu_batch *batch);
+int mt7927_mcu_batch_begin(struct mt7927_mcu_batch *batch, int cmd,
+                           const void *hdr, int hdr_len);
+void *mt7927_mcu_batch_add_tlv(struct mt7927_mcu_batch *batch,
+                               u16 tag, u16 len);
+int mt7927_mcu_batch_commit(struct mt7927_mcu_batch *batch);
+void mt7927_mcu_batch_abort(struct mt7927_mcu_batch *batch);
 
 /* Firmware loading */
 int mt7927_mcu_patch_sem_ctrl(struct mt7927_dev *dev, bool get);
 int mt7927_mcu_start_patch(struct mt7927_dev *dev);
 int mt7927_mcu_start_firmware(struct mt7927_dev *dev, u32 addr);
+int mt7927_mcu_send_fw_segment(struct mt7927_dev *dev, int cmd,
+                               dma_addr_t addr, u32 len);
 int mt7927_mcu_send_firmware(struct mt7927_dev *dev, int cmd,
-                             const void *data, int len);
+                             const struct mt7927_fw_map *map,
+                             u32 offset, u32 len);
 
 #endif /* __MT7927_MCU_H */
@@ -176,6 +176,239 @@ int mt7927_wpdma_reset(struct mt7927_dev *dev, bool force)
     return 0;
 }
 
+/**
+ * mt7927_chip_init - Bring the chip from power-on to a DMA-ready state
+ *
+ * CB_INFRA/WFSYS bring-up shared by probe and by every recovery path:
+ * sleep protection, LPCTL ownership handshake and WFSYS reset. Host
+ * interrupts are left masked.
+ */
+static int mt7927_chip_init(struct mt7927_dev *dev)
+{
+    int ret;
+
+    /* Set EMI control for sleep protection */
+    mt7927_rmw_field(dev, MT_HW_EMI_CTL, MT_HW_EMI_CTL_SLPPROT_EN, 1);
+
+    /* Step 1: Release power control to firmware */
+    ret = mt7927_mcu_fw_pmctrl(dev);
+    if (ret) {
+        dev_warn(dev->dev, "FW power control failed (may be expected)\n");
+        /* Continue anyway - this might fail on first init */
+    }
+
+    /* Step 2: Acquire power control for driver */
+    ret = mt7927_mcu_drv_pmctrl(dev);
+    if (ret) {
+        dev_warn(dev->dev, "Driver power control failed (may be expected)\n");
+        /* Continue anyway */
+    }
+
+    /* Step 3: Reset WiFi subsystem */
+    ret = mt7927_wfsys_reset(dev);
+
+    /* Disable all interrupts initially */
+    mt7927_wr(dev, dev->irq_map->host_irq_enable, 0);
+    mt7927_wr(dev, MT_PCIE_MAC_INT_ENABLE, 0xff);
+
+    return ret;
+}
+
+/**
+ * mt7927_hw_stop - Quiesce the device ahead of a reset
+ *
+ * Masks the IRQ line, stops the tasklet, the MCU and both DMA engines.
+ * Descriptor rings stay allocated. Safe to call on a chip that reads
+ * back all-ones.
+ */
+static void mt7927_hw_stop(struct mt7927_dev *dev)
+{
+    mt7927_pm_stop(dev);
+
+    disable_irq(dev->irq);
+    tasklet_disable(&dev->irq_tasklet);
+    napi_disable(&dev->rx_napi);
+    napi_disable(&dev->tx_napi);
+
+    if (!mt7927_chip_is_dead(dev))
+        mt7927_wr(dev, dev->irq_map->host_irq_enable, 0);
+
+    mt7927_mcu_exit(dev);
+    mt7927_dma_disable(dev, true);
+}
+
+/**
+ * mt7927_hw_unmask - Undo the IRQ and NAPI half of mt7927_hw_stop()
+ *
+ * Every path out of a stop goes through here, restarted or not, so the
+ * disable counts stay balanced for remove.
+ */
+static void mt7927_hw_unmask(struct mt7927_dev *dev)
+{
+    napi_enable(&dev->rx_napi);
+    napi_enable(&dev->tx_napi);
+    tasklet_enable(&dev->irq_tasklet);
+    enable_irq(dev->irq);
+}
+
+/**
+ * mt7927_hw_restart - Re-run bring-up after mt7927_hw_stop()
+ *
+ * The retained rings are reprogrammed in place and the firmware images
+ * already held in dev->fw_patch/fw_ram are reused, so this neither
+ * allocates rings nor goes back to the filesystem.
+ */
+static int mt7927_hw_restart(struct mt7927_dev *dev)
+{
+    int ret;
+
+    ret = mt7927_chip_init(dev);
+
+    /* MCU bring-up waits on interrupts, so unmask before DMA/MCU init */
+    mt7927_hw_unmask(dev);
+
+    if (ret) {
+        dev_err(dev->dev, "WiFi reset failed during recovery: %d\n", ret);
+        return ret;
+    }
+
+    ret = mt7927_dma_reset(dev);
+    if (ret)
+        return ret;
+
+    return mt7927_mcu_init(dev);
+}
+
+/**
+ * mt7927_restore_pci_state - Reload the config space saved at probe
+ *
+ * After a reset the live config space cannot be trusted (a dead chip
+ * reads back all-ones), so always restore the copy taken at probe.
+ */
+static void mt7927_restore_pci_state(struct mt7927_dev *dev)
+{
+    if (dev->pci_state)
+        pci_load_saved_state(dev->pdev, dev->pci_state);
+    pci_restore_state(dev->pdev);
+}
+
+/**
+ * mt7927_restart_mac - Hand the recovered chip back to mac80211
+ *
+ * The firmware lost every interface and station, so an active mac80211
+ * is asked to replay its configuration; otherwise just reopen the queues.
+ */
+static void mt7927_restart_mac(struct mt7927_dev *dev)
+{
+    if (test_bit(MT7927_STATE_RUNNING, &dev->state))
+        ieee80211_restart_hw(dev->hw);
+    else
+        ieee80211_wake_queues(dev->hw);
+}
+
+/**
+ * mt7927_mark_dead - Give the chip up after recovery failed
+ *
+ * Queues stay stopped and further reset requests are ignored. mac80211
+ * is told through the hardware rfkill state, which takes the interfaces
+ * down; rebinding the driver is the way back.
+ */
+static void mt7927_mark_dead(struct mt7927_dev *dev)
+{
+    set_bit(MT7927_STATE_DEAD, &dev->state);
+    clear_bit(MT7927_STATE_RESET, &dev->state);
+
+    dev_err(dev->dev, "Chip recovery gave up, device disabled\n");
+    wiphy_rfkill_set_hw_state(dev->hw->wiphy, true);
+}
+
+/**
+ * mt7927_reset_work - Function-level reset and re-initialization
+ *
+ * Replaces the manual `make recover` remove/rescan cycle: reset the
+ * function, restore config space and bring the chip back up while
+ * keeping the device structure, IRQ and firmware images in place.
+ */
+static void mt7927_reset_work(struct work_struct *work)
+{
+    struct mt7927_dev *dev = container_of(to_delayed_work(work),
+                                          struct mt7927_dev, reset_work);
+    unsigned long start = jiffies;
+    int ret;
+
+    dev_warn(dev->dev, "Chip recovery started\n");
+
+    ieee80211_stop_queues(dev->hw);
+
+    mutex_lock(&dev->mutex);
+
+    mt7927_hw_stop(dev);
+
+    /*
+     * pci_reset_function() would block on the device lock, which is
+     * held across remove() while it waits for this work to finish.
+     * Use the try variant and retry with backoff unless the device is
+     * going away; once the retries run out, recover without the FLR.
+     */
+    ret = pci_try_reset_function(dev->pdev);
+    if (ret == -EAGAIN && !test_bit(MT7927_STATE_REMOVING, &dev->state) &&
+        dev->reset_retries < MT7927_RESET_RETRY_MAX) {
+        mt7927_hw_unmask(dev);
+        mutex_unlock(&dev->mutex);
+        schedule_delayed_work(&dev->reset_work,
+                              MT7927_RESET_RETRY_DELAY << dev->reset_retries++);
+        return;
+    }
+    if (ret)
+        dev_warn(dev->dev, "Function-level reset failed: %d\n", ret);
+
+    mt7927_restore_pci_state(dev);
+
+    ret = mt7927_hw_restart(dev);
+
+    mutex_unlock(&dev->mutex);
+
+    /* Try again from the top a few times, then leave the chip dead */
+    if (ret) {
+        dev_err(dev->dev, "Chip recovery failed: %d\n", ret);
+        if (test_bit(MT7927_STATE_REMOVING, &dev->state))
+            return;
+        if (++dev->reset_attempts >= MT7927_RESET_ATTEMPTS_MAX) {
+            mt7927_mark_dead(dev);
+            return;
+        }
+        dev->reset_retries = 0;
+        schedule_delayed_work(&dev->reset_work, MT7927_RESET_ATTEMPT_DELAY);
+        return;
+    }
+
+    clear_bit(MT7927_STATE_RESET, &dev->state);
+    mt7927_pm_start(dev);
+    mt7927_restart_mac(dev);
+    dev_info(dev->dev, "Chip recovered in %u ms\n",
+             jiffies_to_msecs(jiffies - start));
+}
+
+/**
+ * mt7927_reset - Schedule chip recovery
+ *
+ * Callable from any context. Requests arriving while a reset is already
+ * pending or running are folded into it.
+ */
+void mt7927_reset(struct mt7927_dev *dev)
+{
+    if (test_bit(MT7927_STATE_REMOVING, &dev->state) ||
+        test_bit(MT7927_STATE_DEAD, &dev->state))
+        return;
+
+    if (test_and_set_bit(MT7927_STATE_RESET, &dev->state))
+        return;
+
+    dev->reset_retries = 0;
+    dev->reset_attempts = 0;
+    schedule_delayed_work(&dev->reset_work, 0);
+}
+
 /* ============================================
  * IRQ Handling
  * ============================================ */
@@ -185,7 +418,12 @@ int mt7927_wpdma_reset(struct mt7927_dev *dev, bool force)
  */
 void mt7927_irq_enable(struct mt7927_dev *dev, u32 mask)
 {
+    unsigned long flags;
+
+    /* The tasklet and the RX NAPI poll unmask from different CPUs */
+    spin_lock_irqsave(&dev->lock, flags);
     mt7927_set(dev, dev->irq_map->host_irq_enable, mask);
+    spin_unlock_irqrestore(&dev->lock, flags);
 }
 
 /**
@@ -193,7 +431,11 @@ void mt7927_irq_enable(struct mt7927_dev *dev, u32 mask)
  */
 void mt7927_irq_disable(struct mt7927_dev *dev, u32 mask)
 {
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->lock, flags);
     mt7927_clear(dev, dev->irq_map->host_irq_enable, mask);
+    spin_unlock_irqrestore(&dev->lock, flags);
 }
 
 /**
@@ -204,20 +446,24 @@ void mt7927_irq_tasklet(unsigned long data)
     struct mt7927_dev *dev = (struct mt7927_dev *)data;
     u32 intr, mask;
 
+    /* Dozing: the wake work reschedules us once the driver owns the chip */
+    if (!mt7927_pm_ref(dev))
+        return;
+
     /* Read and acknowledge interrupts */
     intr = mt7927_rr(dev, MT_WFDMA0_HOST_INT_STA);
     mt7927_wr(dev, MT_WFDMA0_HOST_INT_STA, intr);
 
-    dev_info(dev->dev, "IRQ tasklet: intr=0x%08x\n", intr);
+    dev_dbg(dev->dev, "IRQ tasklet: intr=0x%08x\n", intr);
 
     if (!intr)
         return;
 
     /* Process TX completion */
     if (intr & dev->irq_map->tx.all_complete_mask) {
-        /* TX queue 0 (data) */
+        /* TX queue 0 (data) - reaped in bulk by NAPI */
         if (intr & MT_INT_TX_DONE_BAND0)
-            mt7927_tx_complete(dev, &dev->tx_q[0]);
+            napi_schedule(&dev->tx_napi);
 
         /* MCU WM queue (ring 15) - tx_q[1]
          * Fallback: If using rings 4/5, change to HOST_TX_DONE_INT_ENA5 */
@@ -237,8 +483,8 @@ void mt7927_irq_tasklet(unsigned long data)
     }
 
     if (intr & dev->irq_map->rx.data_complete_mask) {
-        /* Data RX */
-        mt7927_rx_poll(dev, &dev->rx_q[MT7927_RXQ_BAND0], 64);
+        /* Data RX is drained in batches by NAPI */
+        napi_schedule(&dev->rx_napi);
     }
 
     /* MCU command notification */
@@ -246,10 +492,14 @@ void mt7927_irq_tasklet(unsigned long data)
         wake_up(&dev->mcu.wait);
     }
 
-    /* Re-enable interrupts */
+    /* Re-enable interrupts; data RX/TX done are unmasked by their NAPI */
     mask = dev->irq_map->tx.all_complete_mask |
            MT_INT_RX_DONE_ALL |
            MT_INT_MCU_CMD;
+    if (napi_is_scheduled(&dev->rx_napi))
+        mask &= ~dev->irq_map->rx.data_complete_mask;
+    if (napi_is_scheduled(&dev->tx_napi))
+        mask &= ~MT_INT_TX_DONE_BAND0;
     mt7927_irq_enable(dev, mask);
 }
 
@@ -261,11 +511,21 @@ irqreturn_t mt7927_irq_handler(int irq, void *dev_instance)
     struct mt7927_dev *dev = dev_instance;
     u32 intr;
 
+    if (test_bit(MT7927_STATE_RESET, &dev->state) ||
+        test_bit(MT7927_STATE_DEAD, &dev->state))
+        return IRQ_NONE;
+
     /* Quick check for our interrupt */
     intr = mt7927_rr(dev, MT_WFDMA0_HOST_INT_STA);
     if (!intr)
         return IRQ_NONE;
 
+    /* All-ones means the chip fell off the bus */
+    if (intr == ~0U && mt7927_chip_is_dead(dev)) {
+        mt7927_reset(dev);
+        return IRQ_NONE;
+    }
+
     /* Disable further interrupts and schedule tasklet */
     mt7927_wr(dev, dev->irq_map->host_irq_enable, 0);
     tasklet_schedule(&dev->irq_tasklet);
@@ -280,14 +540,14 @@ irqreturn_t mt7927_irq_handler(int irq, void *dev_instance)
 static int mt7927_pci_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 {
     struct mt7927_dev *dev;
-    int ret;
+    int i, ret;
     u16 cmd;
 
     dev_info(&pdev->dev, "MT7927 WiFi 7 device found (PCI ID: %04x:%04x)\n",
              pdev->vendor, pdev->device);
 
-    /* Allocate device structure */
-    dev = devm_kzalloc(&pdev->dev, sizeof(*dev), GFP_KERNEL);
+    /* Allocate device structure (embedded in the ieee80211_hw) */
+    dev = mt7927_alloc_device(pdev);
     if (!dev)
         return -ENOMEM;
 
@@ -299,11 +559,21 @@ static int mt7927_pci_probe(struct pci_dev *pdev, const struct pci_device_id *id
     /* Initialize locks */
     spin_lock_init(&dev->lock);
     mutex_init(&dev->mutex);
+    INIT_DELAYED_WORK(&dev->reset_work, mt7927_reset_work);
+    mt7927_pm_init(dev);
 
     /* Initialize MCU state */
-    skb_queue_head_init(&dev->mcu.res_q);
+    spin_lock_init(&dev->mcu.lock);
     init_waitqueue_head(&dev->mcu.wait);
+    for (i = 0; i < ARRAY_SIZE(dev->mcu.req); i++)
+        init_completion(&dev->mcu.req[i].done);
     dev->mcu.timeout = 3 * HZ;
+    mutex_init(&dev->fw_cache.lock);
+    INIT_LIST_HEAD(&dev->fw_cache.entries);
+
+    dev->mcu.lat = devm_alloc_percpu(&pdev->dev, struct mt7927_mcu_lat);
+    if (!dev->mcu.lat)
+        return -ENOMEM;
 
     /* Enable PCI device */
     ret = pcim_enable_device(pdev);
@@ -371,39 +641,24 @@ static int mt7927_pci_probe(struct pci_dev *pdev, const struct pci_device_id *id
     dev_info(&pdev->dev, "Chip ID: 0x%08x, HW Rev: 0x%02x\n",
              dev->chip_id, dev->hw_rev);
 
-    /* Set EMI control for sleep protection */
-    mt7927_rmw_field(dev, MT_HW_EMI_CTL, MT_HW_EMI_CTL_SLPPROT_EN, 1);
-
-    /* Step 1: Release power control to firmware */
-    ret = mt7927_mcu_fw_pmctrl(dev);
-    if (ret) {
-        dev_warn(&pdev->dev, "FW power control failed (may be expected)\n");
-        /* Continue anyway - this might fail on first init */
-    }
-
-    /* Step 2: Acquire power control for driver */
-    ret = mt7927_mcu_drv_pmctrl(dev);
+    /* Steps 1-3: Power handshake and WiFi subsystem reset */
+    ret = mt7927_chip_init(dev);
     if (ret) {
-        dev_warn(&pdev->dev, "Driver power control failed (may be expected)\n");
-        /* Continue anyway */
+        dev_warn(&pdev->dev, "WiFi reset failed, continuing...\n");
     }
 
-    /* Step 3: Reset WiFi subsystem */
-    ret = mt7927_wfsys_reset(dev);
+    ret = mt7927_mcu_event_init(dev);
     if (ret) {
-        dev_warn(&pdev->dev, "WiFi reset failed, continuing...\n");
+        dev_err(&pdev->dev, "Failed to create MCU event workqueue\n");
+        goto err_tasklet;
     }
 
-    /* Disable all interrupts initially */
-    mt7927_wr(dev, dev->irq_map->host_irq_enable, 0);
-    mt7927_wr(dev, MT_PCIE_MAC_INT_ENABLE, 0xff);
-
     /* Request IRQ - use request_irq for explicit control in error path */
     ret = request_irq(dev->irq, mt7927_irq_handler,
                       IRQF_SHARED, "mt7927", dev);
     if (ret) {
         dev_err(&pdev->dev, "Failed to request IRQ %d\n", dev->irq);
-        goto err_tasklet;
+        goto err_event;
     }
 
     /* Step 4: Initialize DMA */
@@ -420,13 +675,27 @@ static int mt7927_pci_probe(struct pci_dev *pdev, const struct pci_device_id *id
         goto err_dma;
     }
 
+    /* Step 6: Register with mac80211 */
+    ret = mt7927_register_device(dev);
+    if (ret)
+        goto err_mcu;
+
     /* Mark device as initialized */
     set_bit(MT7927_STATE_INITIALIZED, &dev->state);
     dev->hw_init_done = true;
 
+    /* Snapshot known-good config space for function-level reset */
+    pci_save_state(pdev);
+    dev->pci_state = pci_store_saved_state(pdev);
+
+    mt7927_init_debugfs(dev);
+    mt7927_pm_start(dev);
+
     dev_info(&pdev->dev, "MT7927 driver initialized successfully\n");
     return 0;
 
+err_mcu:
+    mt7927_mcu_exit(dev);
 err_dma:
     mt7927_dma_cleanup(dev);
 err_free_irq:
@@ -434,6 +703,8 @@ err_free_irq:
     mt7927_wr(dev, dev->irq_map->host_irq_enable, 0);
     synchronize_irq(dev->irq);
     free_irq(dev->irq, dev);
+err_event:
+    mt7927_mcu_event_exit(dev);
 err_tasklet:
     tasklet_kill(&dev->irq_tasklet);
 err_free_irq_vectors:
@@ -447,6 +718,17 @@ static void mt7927_pci_remove(struct pci_dev *pdev)
 
     dev_info(&pdev->dev, "Removing MT7927 device\n");
 
+    /* Stop recovery from racing with teardown */
+    set_bit(MT7927_STATE_REMOVING, &dev->state);
+    cancel_delayed_work_sync(&dev->reset_work);
+
+    mt7927_unregister_device(dev);
+    mt7927_exit_debugfs(dev);
+
+    /* Take the chip back from firmware before touching registers */
+    mt7927_pm_stop(dev);
+    skb_queue_purge(&dev->pm.tx_q);
+
     /* Disable interrupts */
     mt7927_wr(dev, dev->irq_map->host_irq_enable, 0);
 
@@ -459,6 +741,8 @@ static void mt7927_pci_remove(struct pci_dev *pdev)
     /* Free IRQ - must be before pci_free_irq_vectors */
     free_irq(dev->irq, dev);
 
+    mt7927_mcu_event_exit(dev);
+
     /* Kill tasklet */
     tasklet_kill(&dev->irq_tasklet);
 
@@ -470,6 +754,13 @@ static void mt7927_pci_remove(struct pci_dev *pdev)
         release_firmware(dev->fw_ram);
     if (dev->fw_patch)
         release_firmware(dev->fw_patch);
+
+    mt7927_mcu_cache_flush(dev);
+    mt7927_fw_crc_free(&dev->fw_patch_crc);
+    mt7927_fw_crc_free(&dev->fw_ram_crc);
+
+    kfree(dev->pci_state);
+    dev->pci_state = NULL;
 }
 
 static void mt7927_pci_shutdown(struct pci_dev *pdev)
@@ -477,6 +768,186 @@ static void mt7927_pci_shutdown(struct pci_dev *pdev)
     mt7927_pci_remove(pdev);
 }
 
+/* ============================================
+ * System Suspend/Resume
+ * ============================================ */
+
+/**
+ * mt7927_fw_running - Check whether the WM firmware survived suspend
+ */
+static bool mt7927_fw_running(struct mt7927_dev *dev)
+{
+    u32 val = mt7927_rr(dev, MT_CONN_ON_MISC);
+
+    return FIELD_GET(MT_TOP_MISC2_FW_N9_RDY, val) == MT_TOP_MISC2_FW_N9_RDY_VAL;
+}
+
+static int mt7927_pci_suspend(struct device *device)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(device);
+    int ret;
+
+    /* Let a pending recovery finish before taking the chip down */
+    flush_delayed_work(&dev->reset_work);
+
+    /* System suspend drives the LPCTL handshake itself */
+    mt7927_pm_stop(dev);
+
+    mutex_lock(&dev->mutex);
+
+    disable_irq(dev->irq);
+    tasklet_disable(&dev->irq_tasklet);
+    napi_disable(&dev->rx_napi);
+    napi_disable(&dev->tx_napi);
+
+    ret = mt7927_dma_suspend(dev);
+    if (ret)
+        dev_warn(dev->dev, "DMA did not go idle before suspend: %d\n", ret);
+
+    /* Rings and firmware images stay allocated for resume */
+    ret = mt7927_mcu_fw_pmctrl(dev);
+    if (ret) {
+        mt7927_dma_resume(dev);
+        napi_enable(&dev->rx_napi);
+        napi_enable(&dev->tx_napi);
+        tasklet_enable(&dev->irq_tasklet);
+        enable_irq(dev->irq);
+        mutex_unlock(&dev->mutex);
+        mt7927_pm_start(dev);
+        return ret;
+    }
+
+    set_bit(MT7927_STATE_SUSPEND, &dev->state);
+    mutex_unlock(&dev->mutex);
+
+    return 0;
+}
+
+static int mt7927_pci_resume(struct device *device)
+{
+    struct mt7927_dev *dev = dev_get_drvdata(device);
+    unsigned long start = jiffies;
+    bool full = false;
+    int ret;
+
+    mutex_lock(&dev->mutex);
+
+    ret = mt7927_mcu_drv_pmctrl(dev);
+    if (ret) {
+        dev_warn(dev->dev, "drv_pmctrl on resume failed: %d\n", ret);
+        full = true;
+    }
+
+    napi_enable(&dev->rx_napi);
+    napi_enable(&dev->tx_napi);
+    tasklet_enable(&dev->irq_tasklet);
+    enable_irq(dev->irq);
+
+    /* Fast path: rings and firmware survived, just restart DMA */
+    if (!full && dev->mcu.state == MT7927_MCU_STATE_RUNNING &&
+        mt7927_fw_running(dev) && !mt7927_dma_resume(dev))
+        goto out;
+
+    /* The chip lost power: redo bring-up on the retained rings/images */
+    full = true;
+    dev_info(dev->dev, "Chip lost state across suspend, re-initializing\n");
+
+    mt7927_mcu_exit(dev);
+    ret = mt7927_chip_init(dev);
+    if (!ret)
+        ret = mt7927_dma_reset(dev);
+    if (!ret)
+        ret = mt7927_mcu_init(dev);
+
+out:
+    clear_bit(MT7927_STATE_SUSPEND, &dev->state);
+    mutex_unlock(&dev->mutex);
+
+    if (ret) {
+        dev_err(dev->dev, "Resume failed: %d\n", ret);
+        return ret;
+    }
+
+    mt7927_pm_start(dev);
+
+    dev_info(dev->dev, "Resumed (%s) in %u ms\n",
+             full ? "firmware reload" : "state retained",
+             jiffies_to_msecs(jiffies - start));
+    return 0;
+}
+
+static DEFINE_SIMPLE_DEV_PM_OPS(mt7927_pm_ops, mt7927_pci_suspend,
+                                mt7927_pci_resume);
+
+/* ============================================
+ * PCI Error Recovery
+ * ============================================ */
+
+static pci_ers_result_t mt7927_pci_error_detected(struct pci_dev *pdev,
+                                                  pci_channel_state_t state)
+{
+    struct mt7927_dev *dev = pci_get_drvdata(pdev);
+
+    dev_warn(&pdev->dev, "PCI error detected (state %d)\n", state);
+
+    if (state == pci_channel_io_perm_failure)
+        return PCI_ERS_RESULT_DISCONNECT;
+
+    /* The core owns recovery from here; keep our own work out of it */
+    set_bit(MT7927_STATE_RESET, &dev->state);
+    cancel_delayed_work_sync(&dev->reset_work);
+    ieee80211_stop_queues(dev->hw);
+
+    mutex_lock(&dev->mutex);
+    mt7927_hw_stop(dev);
+    mutex_unlock(&dev->mutex);
+
+    return PCI_ERS_RESULT_NEED_RESET;
+}
+
+static pci_ers_result_t mt7927_pci_slot_reset(struct pci_dev *pdev)
+{
+    struct mt7927_dev *dev = pci_get_drvdata(pdev);
+    int ret;
+
+    dev_info(&pdev->dev, "PCI slot reset\n");
+
+    mt7927_restore_pci_state(dev);
+
+    mutex_lock(&dev->mutex);
+    if (mt7927_chip_is_dead(dev)) {
+        /* Balance error_detected() so remove can still tear down */
+        mt7927_hw_unmask(dev);
+        ret = -EIO;
+    } else {
+        ret = mt7927_hw_restart(dev);
+    }
+    mutex_unlock(&dev->mutex);
+
+    if (ret) {
+        mt7927_mark_dead(dev);
+        return PCI_ERS_RESULT_DISCONNECT;
+    }
+
+    return PCI_ERS_RESULT_RECOVERED;
+}
+
+static void mt7927_pci_err_resume(struct pci_dev *pdev)
+{
+    struct mt7927_dev *dev = pci_get_drvdata(pdev);
+
+    clear_bit(MT7927_STATE_RESET, &dev->state);
+    mt7927_pm_start(dev);
+    mt7927_restart_mac(dev);
+    dev_info(&pdev->dev, "PCI error recovery complete\n");
+}
+
+static const struct pci_error_handlers mt7927_pci_err_handlers = {
+    .error_detected = mt7927_pci_error_detected,
+    .slot_reset     = mt7927_pci_slot_reset,
+    .resume         = mt7927_pci_err_resume,
+};
+
 /* PCI device table */
 static const struct pci_device_id mt7927_pci_table[] = {
     { PCI_DEVICE(MT7927_VENDOR_ID, MT7927_DEVICE_ID) },
@@ -491,6 +962,8 @@ static struct pci_driver mt7927_pci_driver = {
     .probe      = mt7927_pci_probe,
     .remove     = mt7927_pci_remove,
     .shutdown   = mt7927_pci_shutdown,
+    .err_handler = &mt7927_pci_err_handlers,
+    .driver.pm  = pm_sleep_ptr(&mt7927_pm_ops),
 };
 
 module_pci_driver(mt7927_pci_driver);
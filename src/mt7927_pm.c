@@ -0,0 +1,565 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * MT7927 WiFi 7 Linux Driver - Runtime Power Management
+ *
+ * Hands LPCTL ownership to firmware after an idle period and takes it
+ * back lazily when TX, RX or an MCU command needs the bus
+ *
+ * Copyright (C) 2024 MT7927 Linux Driver Project
+ */
+
+#include <linux/module.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+
+#include "mt7927.h"
+
+static bool runtime_pm = true;
+module_param(runtime_pm, bool, 0644);
+MODULE_PARM_DESC(runtime_pm, "Hand the chip to firmware when idle (default: true)");
+
+static bool link_pm = true;
+module_param(link_pm, bool, 0644);
+MODULE_PARM_DESC(link_pm, "Enable ASPM only while traffic is light (default: true)");
+
+/* LPCTL handshake budget for runtime transitions */
+#define MT7927_PM_OWN_TIMEOUT_MS        20
+
+/* ============================================
+ * LPCTL Ownership Handshake
+ * ============================================ */
+
+/**
+ * mt7927_pm_set_own - Quiet, low-latency LPCTL handshake
+ * @dev: device structure
+ * @fw: true to hand ownership to firmware, false to claim it for the driver
+ *
+ * Same protocol as mt7927_mcu_fw_pmctrl()/mt7927_mcu_drv_pmctrl(), but
+ * polls at a fine granularity and without logging, since it runs on every
+ * runtime transition rather than once at probe.
+ */
+static int mt7927_pm_set_own(struct mt7927_dev *dev, bool fw)
+{
+    ktime_t timeout = ktime_add_ms(ktime_get(), MT7927_PM_OWN_TIMEOUT_MS);
+    u32 val;
+
+    mt7927_wr(dev, MT_CONN_ON_LPCTL,
+              fw ? PCIE_LPCR_HOST_SET_OWN : PCIE_LPCR_HOST_CLR_OWN);
+
+    for (;;) {
+        val = mt7927_rr(dev, MT_CONN_ON_LPCTL);
+        if (!!(val & PCIE_LPCR_HOST_OWN_SYNC) == fw)
+            return 0;
+
+        if (ktime_after(ktime_get(), timeout))
+            break;
+
+        usleep_range(10, 20);
+    }
+
+    dev_err(dev->dev, "Runtime %s own timeout (LPCTL: 0x%08x)\n",
+            fw ? "fw" : "drv", val);
+    return -ETIMEDOUT;
+}
+
+/**
+ * mt7927_pm_can_doze - Check whether handing off to firmware is allowed
+ */
+static bool mt7927_pm_can_doze(struct mt7927_dev *dev)
+{
+    return dev->pm.enable &&
+           test_bit(MT7927_STATE_MCU_RUNNING, &dev->state) &&
+           !test_bit(MT7927_STATE_RESET, &dev->state) &&
+           !test_bit(MT7927_STATE_SUSPEND, &dev->state) &&
+           !test_bit(MT7927_STATE_REMOVING, &dev->state);
+}
+
+/**
+ * mt7927_pm_tx_idle - Check that no data or MCU frame is still in flight
+ *
+ * Taking each queue lock also waits out a submitter that passed
+ * mt7927_pm_ref() just before fw_own was set.
+ */
+static bool mt7927_pm_tx_idle(struct mt7927_dev *dev)
+{
+    unsigned long flags;
+    bool idle = true;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(dev->tx_q); i++) {
+        struct mt7927_queue *q = &dev->tx_q[i];
+
+        if (!q->desc)
+            continue;
+
+        spin_lock_irqsave(&q->lock, flags);
+        if (q->head != q->tail)
+            idle = false;
+        spin_unlock_irqrestore(&q->lock, flags);
+    }
+
+    return idle;
+}
+
+/* ============================================
+ * Doze / Wake
+ * ============================================ */
+
+static void mt7927_pm_ps_work(struct work_struct *work)
+{
+    struct mt7927_dev *dev = container_of(work, struct mt7927_dev,
+                                          pm.ps_work.work);
+    struct mt7927_pm *pm = &dev->pm;
+    unsigned long flags, delta;
+    int ret;
+
+    mutex_lock(&pm->mutex);
+
+    if (pm->fw_own || !mt7927_pm_can_doze(dev))
+        goto out;
+
+    spin_lock_irqsave(&pm->lock, flags);
+    delta = pm->last_activity + pm->idle_timeout - jiffies;
+    if (pm->users || time_before(jiffies, pm->last_activity + pm->idle_timeout)) {
+        spin_unlock_irqrestore(&pm->lock, flags);
+        if (!pm->users)
+            queue_delayed_work(system_power_efficient_wq, &pm->ps_work, delta);
+        goto out;
+    }
+    /* From here on new TX is parked in pm->tx_q */
+    pm->fw_own = true;
+    spin_unlock_irqrestore(&pm->lock, flags);
+
+    if (!mt7927_pm_tx_idle(dev)) {
+        ret = -EBUSY;
+        goto abort;
+    }
+
+    ret = mt7927_pm_set_own(dev, true);
+    if (ret)
+        goto abort;
+
+    pm->stats.doze_count++;
+    pm->stats.awake_time += jiffies - pm->stats.last_change;
+    pm->stats.last_change = jiffies;
+    goto out;
+
+abort:
+    spin_lock_irqsave(&pm->lock, flags);
+    pm->fw_own = false;
+    pm->last_activity = jiffies;
+    spin_unlock_irqrestore(&pm->lock, flags);
+    queue_delayed_work(system_power_efficient_wq, &pm->ps_work,
+                       pm->idle_timeout);
+    queue_work(system_highpri_wq, &pm->wake_work);
+out:
+    mutex_unlock(&pm->mutex);
+}
+
+/**
+ * __mt7927_pm_wake - Claim ownership back from firmware
+ *
+ * Caller holds pm->mutex. Parked TX is flushed to the data ring and the
+ * IRQ tasklet is kicked for anything that arrived while dozing.
+ */
+static int __mt7927_pm_wake(struct mt7927_dev *dev)
+{
+    struct mt7927_pm *pm = &dev->pm;
+    struct sk_buff *skb;
+    unsigned long flags;
+    ktime_t start;
+    u32 lat;
+    int ret;
+
+    if (pm->fw_own) {
+        start = ktime_get();
+        ret = mt7927_pm_set_own(dev, false);
+        if (ret)
+            return ret;
+
+        lat = ktime_us_delta(ktime_get(), start);
+        pm->stats.wake_count++;
+        pm->stats.wake_lat_last_us = lat;
+        pm->stats.wake_lat_total_us += lat;
+        pm->stats.wake_lat_max_us = max(pm->stats.wake_lat_max_us, lat);
+        pm->stats.doze_time += jiffies - pm->stats.last_change;
+        pm->stats.last_change = jiffies;
+
+        spin_lock_irqsave(&pm->lock, flags);
+        pm->fw_own = false;
+        pm->last_activity = jiffies;
+        spin_unlock_irqrestore(&pm->lock, flags);
+
+        tasklet_schedule(&dev->irq_tasklet);
+
+        /* A NAPI poll that found the chip dozing left its ring to us */
+        local_bh_disable();
+        napi_schedule(&dev->rx_napi);
+        napi_schedule(&dev->tx_napi);
+        local_bh_enable();
+    }
+
+    /* Also covers frames parked during an aborted doze attempt */
+    while ((skb = skb_dequeue(&pm->tx_q)) != NULL) {
+        if (mt7927_mac_tx_queue(dev, skb))
+            mt7927_mac_tx_drop(dev, skb);
+    }
+
+    /* Resume pulling from mac80211's TXQs */
+    mt7927_tx_kick(dev);
+
+    return 0;
+}
+
+static void mt7927_pm_wake_work(struct work_struct *work)
+{
+    struct mt7927_dev *dev = container_of(work, struct mt7927_dev,
+                                          pm.wake_work);
+    struct mt7927_pm *pm = &dev->pm;
+
+    mutex_lock(&pm->mutex);
+    __mt7927_pm_wake(dev);
+    mutex_unlock(&pm->mutex);
+
+    if (mt7927_pm_can_doze(dev))
+        queue_delayed_work(system_power_efficient_wq, &pm->ps_work,
+                           pm->idle_timeout);
+}
+
+/* ============================================
+ * Users
+ * ============================================ */
+
+/**
+ * mt7927_pm_ref - Mark activity from a context that cannot sleep
+ *
+ * Returns: true if the driver owns the chip and the caller may touch
+ * registers; false if it is dozing, in which case a wake is scheduled.
+ */
+bool mt7927_pm_ref(struct mt7927_dev *dev)
+{
+    struct mt7927_pm *pm = &dev->pm;
+    unsigned long flags;
+    bool awake;
+
+    spin_lock_irqsave(&pm->lock, flags);
+    awake = !pm->fw_own;
+    if (awake)
+        pm->last_activity = jiffies;
+    spin_unlock_irqrestore(&pm->lock, flags);
+
+    if (!awake)
+        queue_work(system_highpri_wq, &pm->wake_work);
+
+    return awake;
+}
+
+/**
+ * mt7927_pm_queue_skb - Park a data frame until the chip is awake
+ */
+void mt7927_pm_queue_skb(struct mt7927_dev *dev, struct sk_buff *skb)
+{
+    skb_queue_tail(&dev->pm.tx_q, skb);
+    queue_work(system_highpri_wq, &dev->pm.wake_work);
+}
+
+/**
+ * mt7927_pm_get - Wake the chip synchronously and hold it awake
+ *
+ * For process-context users such as MCU commands that must keep the
+ * bus until their response arrives. Pair with mt7927_pm_put().
+ */
+int mt7927_pm_get(struct mt7927_dev *dev)
+{
+    struct mt7927_pm *pm = &dev->pm;
+    unsigned long flags;
+    int ret;
+
+    spin_lock_irqsave(&pm->lock, flags);
+    pm->users++;
+    pm->last_activity = jiffies;
+    spin_unlock_irqrestore(&pm->lock, flags);
+
+    /* MCU exchanges are latency sensitive: keep the link out of ASPM */
+    mt7927_link_pm_hint(dev);
+
+    if (!READ_ONCE(pm->fw_own))
+        return 0;
+
+    mutex_lock(&pm->mutex);
+    ret = __mt7927_pm_wake(dev);
+    mutex_unlock(&pm->mutex);
+
+    if (ret)
+        mt7927_pm_put(dev);
+
+    return ret;
+}
+
+/**
+ * mt7927_pm_put - Drop a reference taken by mt7927_pm_get()
+ */
+void mt7927_pm_put(struct mt7927_dev *dev)
+{
+    struct mt7927_pm *pm = &dev->pm;
+    unsigned long flags;
+
+    spin_lock_irqsave(&pm->lock, flags);
+    pm->users--;
+    pm->last_activity = jiffies;
+    spin_unlock_irqrestore(&pm->lock, flags);
+
+    if (mt7927_pm_can_doze(dev))
+        queue_delayed_work(system_power_efficient_wq, &pm->ps_work,
+                           pm->idle_timeout);
+}
+
+/* ============================================
+ * Link (ASPM) Power Policy
+ * ============================================ */
+
+/**
+ * mt7927_link_pm_apply - Switch the link between low-power and performance
+ *
+ * pci_{enable,disable}_link_state() program Link Control on both ends
+ * of the link through config space, so this works while the chip is
+ * dozing.
+ */
+static void mt7927_link_pm_apply(struct mt7927_dev *dev,
+                                 enum mt7927_link_pm_state state)
+{
+    struct mt7927_link_pm *lp = &dev->link_pm;
+    int ret;
+
+    if (lp->state == state)
+        return;
+
+    if (state == MT7927_LINK_PM_PERF)
+        ret = pci_disable_link_state(dev->pdev, MT7927_LINK_PM_STATES);
+    else
+        ret = pci_enable_link_state(dev->pdev, MT7927_LINK_PM_STATES);
+    if (ret) {
+        dev_warn(dev->dev, "ASPM control unavailable (%d), link policy off\n",
+                 ret);
+        lp->enable = false;
+        return;
+    }
+
+    lp->time[lp->state] += jiffies - lp->last_change;
+    lp->last_change = jiffies;
+    lp->state = state;
+    lp->transitions++;
+    lp->high_samples = 0;
+    lp->low_samples = 0;
+
+    dev_dbg(dev->dev, "Link PM: %s\n",
+            state == MT7927_LINK_PM_PERF ? "performance" : "low power");
+}
+
+static void mt7927_link_pm_work(struct work_struct *work)
+{
+    struct mt7927_dev *dev = container_of(work, struct mt7927_dev,
+                                          link_pm.work.work);
+    struct mt7927_link_pm *lp = &dev->link_pm;
+    u32 frames, delta;
+    bool latency;
+
+    if (!lp->enable)
+        return;
+
+    frames = READ_ONCE(dev->tx_q[0].frames) +
+             READ_ONCE(dev->rx_q[MT7927_RXQ_BAND0].frames);
+    delta = frames - lp->last_frames;
+    lp->last_frames = frames;
+
+    latency = time_before(jiffies, READ_ONCE(lp->lat_hint) +
+                                   MT7927_LINK_PM_INTERVAL);
+
+    if (lp->state == MT7927_LINK_PM_LOW_POWER) {
+        if (delta >= MT7927_LINK_PM_HIGH_FRAMES)
+            lp->high_samples++;
+        else
+            lp->high_samples = 0;
+
+        if (latency || lp->high_samples >= MT7927_LINK_PM_HIGH_SAMPLES)
+            mt7927_link_pm_apply(dev, MT7927_LINK_PM_PERF);
+    } else {
+        if (delta < MT7927_LINK_PM_LOW_FRAMES && !latency)
+            lp->low_samples++;
+        else
+            lp->low_samples = 0;
+
+        if (lp->low_samples >= MT7927_LINK_PM_LOW_SAMPLES)
+            mt7927_link_pm_apply(dev, MT7927_LINK_PM_LOW_POWER);
+    }
+
+    if (lp->enable)
+        queue_delayed_work(system_power_efficient_wq, &lp->work,
+                           MT7927_LINK_PM_INTERVAL);
+}
+
+/**
+ * mt7927_link_pm_hint - Note latency-sensitive activity
+ *
+ * Callable from any context. Leaves low-power immediately rather than
+ * waiting for the next sample.
+ */
+void mt7927_link_pm_hint(struct mt7927_dev *dev)
+{
+    struct mt7927_link_pm *lp = &dev->link_pm;
+
+    WRITE_ONCE(lp->lat_hint, jiffies);
+
+    if (lp->enable && lp->state == MT7927_LINK_PM_LOW_POWER)
+        mod_delayed_work(system_power_efficient_wq, &lp->work, 0);
+}
+
+static void mt7927_link_pm_start(struct mt7927_dev *dev)
+{
+    struct mt7927_link_pm *lp = &dev->link_pm;
+
+    if (!lp->enable)
+        return;
+
+    /*
+     * mt7927_mcu_init() sets the chip-side L0s override for firmware
+     * download; hand L0s control back to the Link Control register.
+     */
+    mt7927_clear(dev, MT_PCIE_MAC_PM, MT_PCIE_MAC_PM_L0S_DIS);
+
+    lp->last_frames = READ_ONCE(dev->tx_q[0].frames) +
+                      READ_ONCE(dev->rx_q[MT7927_RXQ_BAND0].frames);
+    mt7927_link_pm_apply(dev, MT7927_LINK_PM_LOW_POWER);
+
+    queue_delayed_work(system_power_efficient_wq, &lp->work,
+                       MT7927_LINK_PM_INTERVAL);
+}
+
+/*
+ * Leaves the link in performance mode, matching the ASPM-off state the
+ * driver has always used around reset and firmware download.
+ */
+static void mt7927_link_pm_stop(struct mt7927_dev *dev)
+{
+    struct mt7927_link_pm *lp = &dev->link_pm;
+    bool enable = lp->enable;
+
+    lp->enable = false;
+    cancel_delayed_work_sync(&lp->work);
+    lp->enable = enable;
+
+    mt7927_link_pm_apply(dev, MT7927_LINK_PM_PERF);
+}
+
+/**
+ * mt7927_link_pm_set_enable - Turn the link power policy on or off
+ */
+void mt7927_link_pm_set_enable(struct mt7927_dev *dev, bool enable)
+{
+    struct mt7927_link_pm *lp = &dev->link_pm;
+
+    if (lp->enable == enable)
+        return;
+
+    if (!enable) {
+        mt7927_link_pm_stop(dev);
+        lp->enable = false;
+        return;
+    }
+
+    lp->enable = true;
+    if (mt7927_pm_get(dev))
+        return;
+    mt7927_link_pm_start(dev);
+    mt7927_pm_put(dev);
+}
+
+/* ============================================
+ * Setup / Teardown
+ * ============================================ */
+
+static void mt7927_pm_doze_start(struct mt7927_dev *dev)
+{
+    struct mt7927_pm *pm = &dev->pm;
+
+    pm->last_activity = jiffies;
+    if (mt7927_pm_can_doze(dev))
+        queue_delayed_work(system_power_efficient_wq, &pm->ps_work,
+                           pm->idle_timeout);
+}
+
+static void mt7927_pm_doze_stop(struct mt7927_dev *dev)
+{
+    struct mt7927_pm *pm = &dev->pm;
+
+    cancel_delayed_work_sync(&pm->ps_work);
+    cancel_work_sync(&pm->wake_work);
+
+    mutex_lock(&pm->mutex);
+    if (pm->fw_own && !mt7927_chip_is_dead(dev))
+        __mt7927_pm_wake(dev);
+    pm->fw_own = false;
+    mutex_unlock(&pm->mutex);
+}
+
+/**
+ * mt7927_pm_start - Arm the idle timer and link policy once the MCU is running
+ */
+void mt7927_pm_start(struct mt7927_dev *dev)
+{
+    mt7927_link_pm_start(dev);
+    mt7927_pm_doze_start(dev);
+}
+
+/**
+ * mt7927_pm_stop - Cancel runtime transitions and leave the driver owning
+ *
+ * Used ahead of system suspend, reset and remove, which all drive the
+ * LPCTL handshake themselves. The link is left with ASPM disabled.
+ */
+void mt7927_pm_stop(struct mt7927_dev *dev)
+{
+    mt7927_pm_doze_stop(dev);
+    mt7927_link_pm_stop(dev);
+}
+
+/**
+ * mt7927_pm_set_enable - Turn runtime PM on or off
+ */
+void mt7927_pm_set_enable(struct mt7927_dev *dev, bool enable)
+{
+    struct mt7927_pm *pm = &dev->pm;
+
+    if (pm->enable == enable)
+        return;
+
+    if (!enable) {
+        pm->enable = false;
+        mt7927_pm_doze_stop(dev);
+        return;
+    }
+
+    pm->enable = true;
+    mt7927_pm_doze_start(dev);
+}
+
+void mt7927_pm_init(struct mt7927_dev *dev)
+{
+    struct mt7927_pm *pm = &dev->pm;
+
+    INIT_DELAYED_WORK(&pm->ps_work, mt7927_pm_ps_work);
+    INIT_WORK(&pm->wake_work, mt7927_pm_wake_work);
+    skb_queue_head_init(&pm->tx_q);
+    spin_lock_init(&pm->lock);
+    mutex_init(&pm->mutex);
+
+    pm->enable = runtime_pm;
+    pm->idle_timeout = MT7927_PM_TIMEOUT;
+    pm->stats.last_change = jiffies;
+
+    INIT_DELAYED_WORK(&dev->link_pm.work, mt7927_link_pm_work);
+    dev->link_pm.enable = link_pm;
+    /* mt7927_mcu_init() leaves ASPM off until the policy starts */
+    dev->link_pm.state = MT7927_LINK_PM_PERF;
+    dev->link_pm.last_change = jiffies;
+}
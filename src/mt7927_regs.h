@@ -252,6 +252,7 @@
 
 /* DMA info field */
 #define MT_DMA_INFO_DMA_FRAG            BIT(9)
+#define MT_DMA_INFO_CSUM_ERR            (BIT(0) | BIT(2) | BIT(3))  /* IP/L4 */
 
 /* ============================================
  * Queue IDs
@@ -307,6 +308,26 @@ enum mt7927_mcu_queue_id {
 #define MT7927_RX_MCU_RING_SIZE         512
 
 #define MT_RX_BUF_SIZE                  2048
+
+/* Per TX ring: small frames are copied into pre-mapped slots */
+#define MT7927_TX_BOUNCE_SLOTS          256
+#define MT7927_TX_BOUNCE_SIZE           256
+
+/*
+ * Data ring flow control: the TXQ scheduler pauses when the byte queue
+ * limit is exceeded or fewer than STOP descriptors are free (room for a
+ * worst-case frame plus frames mac80211 hands us via .tx), and resumes
+ * only once the limit allows more and WAKE descriptors are free.
+ */
+#define MT7927_TX_STOP_DESC             16
+#define MT7927_TX_WAKE_DESC             (MT7927_TX_RING_SIZE / 4)
+
+/* Software A-MSDU: subframes per frame, each its own DMA segment */
+#define MT7927_TX_AMSDU_MAX_SUBFRAMES   8
+#define MT7927_TX_MAX_SEGS              (1 + MT7927_TX_AMSDU_MAX_SUBFRAMES)
+
+/* Coherent TXDs for data frames, enough for a full data ring */
+#define MT7927_TXWI_NUM                 MT7927_TX_RING_SIZE
 #define MT_TX_TOKEN_SIZE                8192
 
 /* ============================================
@@ -0,0 +1,349 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * mt7927_fw_plan - Offline check of the firmware download schedule
+ *
+ * Userspace program, not a module. Parses a ROM patch or RAM image the
+ * way the driver does, runs the driver's own planner (src/mt7927_fw_plan.c)
+ * and prints the schedule in the format of debugfs fw-plan. The schedule
+ * is then checked: every command fits the ring, and the commands cover
+ * each region's bytes exactly once, in order, at the right MCU address.
+ *
+ * Usage: mt7927_fw_plan [-n ring_size] patch|ram <image>
+ * Exits non-zero if the image is rejected or the schedule is wrong.
+ */
+
+#include <endian.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mt7927_fw_plan.h"
+
+/* MT7927_TX_FWDL_RING_SIZE in src/mt7927_regs.h */
+#define FWDL_RING_SIZE          128
+#define FW_MAX_REGIONS          32      /* MT7927_FW_MAX_REGIONS */
+
+/* Image layouts, as in src/mt7927_mcu.h */
+struct patch_hdr {
+    char build_date[16];
+    char platform[4];
+    uint32_t hw_sw_ver;
+    uint32_t patch_ver;
+    uint16_t checksum;
+    uint16_t rsv0;
+    struct {
+        uint32_t patch_ver;
+        uint32_t subsys;
+        uint32_t feature;
+        uint32_t n_region;
+        uint32_t crc;
+        uint32_t rsv[11];
+    } sec_info;
+    uint8_t rsv1[108];
+} __attribute__((packed));
+
+struct patch_sec {
+    uint32_t type;
+    uint32_t offs;
+    uint32_t size;
+    struct {
+        uint32_t addr;
+        uint32_t len;
+        uint32_t sec_key_idx;
+        uint32_t align_len;
+        uint32_t rsv[9];
+    } info;
+} __attribute__((packed));
+
+struct fw_trailer {
+    uint8_t chip_id;
+    uint8_t eco_code;
+    uint8_t n_region;
+    uint8_t format_ver;
+    uint8_t format_flag;
+    uint8_t rsv[2];
+    char fw_ver[10];
+    char build_date[15];
+    uint32_t crc;
+} __attribute__((packed));
+
+struct fw_region {
+    uint32_t decomp_crc;
+    uint32_t decomp_len;
+    uint32_t decomp_blk_sz;
+    uint8_t rsv0[4];
+    uint32_t addr;
+    uint32_t len;
+    uint8_t feature_set;
+    uint8_t type;
+    uint8_t rsv1[14];
+    char name[32];
+} __attribute__((packed));
+
+static int parse_patch(const uint8_t *img, size_t size,
+                       struct mt7927_fw_span **spans)
+{
+    const struct patch_hdr *hdr = (const void *)img;
+    const struct patch_sec *sec;
+    struct mt7927_fw_span *span;
+    uint32_t offset, len;
+    int i, n;
+
+    if (size < sizeof(*hdr)) {
+        fprintf(stderr, "Invalid patch firmware\n");
+        return -EINVAL;
+    }
+
+    n = (int)le32toh(hdr->sec_info.n_region);
+    if (n <= 0 || n > FW_MAX_REGIONS) {
+        fprintf(stderr, "Invalid patch region count %d\n", n);
+        return -EINVAL;
+    }
+
+    if (size - sizeof(*hdr) < n * sizeof(*sec)) {
+        fprintf(stderr, "Patch region table truncated\n");
+        return -EINVAL;
+    }
+
+    span = calloc(n, sizeof(*span));
+    if (!span)
+        return -ENOMEM;
+
+    sec = (const void *)(img + sizeof(*hdr));
+    offset = sizeof(*hdr) + n * sizeof(*sec);
+    for (i = 0; i < n; i++) {
+        len = le32toh(sec[i].info.len);
+        if (offset > size || len > size - offset) {
+            fprintf(stderr, "Patch region %d exceeds firmware size\n", i);
+            free(span);
+            return -EINVAL;
+        }
+
+        span[i].addr = le32toh(sec[i].info.addr);
+        span[i].offset = offset;
+        span[i].len = len;
+        offset += len;
+    }
+
+    printf("build %.16s, %d regions\n", hdr->build_date, n);
+    *spans = span;
+    return n;
+}
+
+static int parse_ram(const uint8_t *img, size_t size,
+                     struct mt7927_fw_span **spans)
+{
+    const struct fw_trailer *trailer;
+    const struct fw_region *region;
+    struct mt7927_fw_span *span;
+    size_t table, data_end;
+    uint32_t offset, len;
+    int i, n;
+
+    if (size < sizeof(*trailer)) {
+        fprintf(stderr, "Invalid RAM firmware\n");
+        return -EINVAL;
+    }
+
+    trailer = (const void *)(img + size - sizeof(*trailer));
+    n = trailer->n_region;
+    table = n * sizeof(*region);
+    if (!n || size - sizeof(*trailer) < table) {
+        fprintf(stderr, "Invalid RAM region count %d\n", n);
+        return -EINVAL;
+    }
+
+    span = calloc(n, sizeof(*span));
+    if (!span)
+        return -ENOMEM;
+
+    data_end = size - sizeof(*trailer) - table;
+    region = (const void *)(img + data_end);
+    offset = 0;
+    for (i = 0; i < n; i++) {
+        len = le32toh(region[i].len);
+        if (offset > data_end || len > data_end - offset) {
+            fprintf(stderr, "RAM region %d exceeds firmware size\n", i);
+            free(span);
+            return -EINVAL;
+        }
+
+        span[i].addr = le32toh(region[i].addr);
+        span[i].offset = offset;
+        span[i].len = len;
+        offset += len;
+    }
+
+    printf("version %.10s, build %.15s, %d regions\n",
+           trailer->fw_ver, trailer->build_date, n);
+    *spans = span;
+    return n;
+}
+
+/*
+ * Walk the commands region by region, the way mt7927_fw_download() sends
+ * the data, and check that every byte lands where its region says.
+ */
+static int check_plan(const struct mt7927_fw_span *span, int n_spans,
+                      const struct mt7927_fw_cmd *cmd, int n_cmds,
+                      uint32_t max_len)
+{
+    int i, r = 0;
+    uint32_t done = 0;      /* Bytes of span[r] already covered */
+
+    for (i = 0; i < n_cmds; i++) {
+        uint32_t pos = cmd[i].offset, end = cmd[i].offset + cmd[i].len;
+        uint32_t addr = cmd[i].addr;
+
+        if (!cmd[i].len || cmd[i].len > max_len) {
+            fprintf(stderr, "cmd %d: length %u outside 1..%u\n",
+                    i, cmd[i].len, max_len);
+            return -1;
+        }
+
+        while (pos < end) {
+            while (r < n_spans && done == span[r].len) {
+                r++;
+                done = 0;
+            }
+            if (r >= n_spans || r < cmd[i].region ||
+                r >= cmd[i].region + cmd[i].n_region) {
+                fprintf(stderr, "cmd %d: offset 0x%x not in its regions\n",
+                        i, pos);
+                return -1;
+            }
+            if (pos != span[r].offset + done ||
+                addr != span[r].addr + done) {
+                fprintf(stderr, "cmd %d: region %d out of order\n", i, r);
+                return -1;
+            }
+
+            uint32_t piece = span[r].len - done;
+
+            if (piece > end - pos)
+                piece = end - pos;
+            pos += piece;
+            addr += piece;
+            done += piece;
+        }
+    }
+
+    while (r < n_spans && done == span[r].len) {
+        r++;
+        done = 0;
+    }
+    if (r != n_spans) {
+        fprintf(stderr, "region %d not fully covered\n", r);
+        return -1;
+    }
+
+    return 0;
+}
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    uint8_t *buf = NULL;
+    size_t cap = 0, len = 0, got;
+    FILE *f = fopen(path, "rb");
+
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+
+    do {
+        if (len == cap) {
+            uint8_t *tmp = realloc(buf, cap = cap ? cap * 2 : 1 << 20);
+
+            if (!tmp) {
+                free(buf);
+                fclose(f);
+                return NULL;
+            }
+            buf = tmp;
+        }
+        got = fread(buf + len, 1, cap - len, f);
+        len += got;
+    } while (got);
+
+    if (ferror(f)) {
+        perror(path);
+        free(buf);
+        buf = NULL;
+    }
+
+    fclose(f);
+    *size = len;
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    struct mt7927_fw_span *spans = NULL;
+    struct mt7927_fw_cmd *cmd = NULL;
+    int ring = FWDL_RING_SIZE;
+    int i, opt, n_spans, n_cmds, ret = 1;
+    uint32_t max_len, segs = 0;
+    uint8_t *img;
+    size_t size;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt != 'n')
+            goto usage;
+        ring = atoi(optarg);
+    }
+
+    if (argc - optind != 2 || ring < 3 ||
+        (strcmp(argv[optind], "patch") && strcmp(argv[optind], "ram")))
+        goto usage;
+
+    img = read_file(argv[optind + 1], &size);
+    if (!img)
+        return 1;
+
+    /* As mt7927_fw_plan_max_len() */
+    max_len = (ring - 2) * MT7927_FW_SEG_MAX;
+
+    printf("%s\n", argv[optind + 1]);
+    n_spans = !strcmp(argv[optind], "patch") ? parse_patch(img, size, &spans) :
+                                               parse_ram(img, size, &spans);
+    if (n_spans < 0)
+        goto out;
+
+    n_cmds = mt7927_fw_plan(spans, n_spans, max_len, NULL);
+    cmd = calloc(n_cmds ? n_cmds : 1, sizeof(*cmd));
+    if (!cmd)
+        goto out;
+    if (mt7927_fw_plan(spans, n_spans, max_len, cmd) != n_cmds) {
+        fprintf(stderr, "planner returned different counts\n");
+        goto out;
+    }
+
+    for (i = 0; i < n_cmds; i++) {
+        segs += (cmd[i].len + MT7927_FW_SEG_MAX - 1) / MT7927_FW_SEG_MAX;
+        printf("  cmd %d: addr 0x%08x offset 0x%06x len %u regions %u-%u\n",
+               i, cmd[i].addr, cmd[i].offset, cmd[i].len, cmd[i].region,
+               cmd[i].region + cmd[i].n_region - 1);
+    }
+
+    printf("  %d regions, %d scatter commands, %u data descriptors (max %u bytes per command)\n",
+           n_spans, n_cmds, segs, max_len);
+
+    if (check_plan(spans, n_spans, cmd, n_cmds, max_len))
+        goto out;
+
+    printf("  schedule OK\n");
+    ret = 0;
+
+out:
+    free(cmd);
+    free(spans);
+    free(img);
+    return ret;
+
+usage:
+    fprintf(stderr, "Usage: %s [-n ring_size] patch|ram <image>\n", argv[0]);
+    return 2;
+}